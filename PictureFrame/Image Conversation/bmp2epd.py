@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Converts a 600 x 448 pixel 4 bit per pixel bitmap (as created by convert.bat)
+into a C array in display native order. The array can be placed into
+images.h and is send without any further conversion to the display.
+
+Usage: python3 bmp2epd.py <image.bmp> <arrayname> [<image.bmp> <arrayname> ...] > images.h
+"""
+import math
+import struct
+import sys
+
+EPD_WIDTH = 600
+EPD_HEIGHT = 448
+
+# Same mapping as setup_color_lut() in bmpreader.cpp: the conversion colors
+# map to their display color, any other color to the closest one in CIELAB
+# (dither_nearest_color() in dither.cpp)
+EPD_BLACK = 0x00
+EPD_WHITE = 0x01
+EPD_GREEN = 0x02
+EPD_BLUE = 0x03
+EPD_RED = 0x04
+EPD_YELLOW = 0x05
+EPD_ORANGE = 0x06
+EPD_TRANSPARENT = 0x07
+
+COLOR_MAP = {
+    0x00ed1c24: EPD_RED,
+    0x00000000: EPD_BLACK,
+    0x0022b14c: EPD_GREEN,
+    0x00fff200: EPD_YELLOW,
+    0x003f48cc: EPD_BLUE,
+    0x00ffe282: EPD_TRANSPARENT,
+    0x00ffffff: EPD_WHITE,
+    0x00ff7f27: EPD_ORANGE,
+}
+
+# Display colors as in the conversion palette, index is the display color
+DITHER_PALETTE = [
+    (0x00, 0x00, 0x00),
+    (0xFF, 0xFF, 0xFF),
+    (0x22, 0xB1, 0x4C),
+    (0x3F, 0x48, 0xCC),
+    (0xED, 0x1C, 0x24),
+    (0xFF, 0xF2, 0x00),
+    (0xFF, 0x7F, 0x27),
+]
+
+
+def srgb_to_linear(value):
+    value = value / 255.0
+    if value <= 0.04045:
+        return value / 12.92
+    return ((value + 0.055) / 1.055) ** 2.4
+
+
+def lab_f(t):
+    if t > 0.008856:
+        return t ** (1.0 / 3.0)
+    return 7.787 * t + 16.0 / 116.0
+
+
+def rgb_to_lab(r, g, b):
+    r, g, b = srgb_to_linear(r), srgb_to_linear(g), srgb_to_linear(b)
+    x = (0.4124 * r + 0.3576 * g + 0.1805 * b) / 0.95047
+    y = 0.2126 * r + 0.7152 * g + 0.0722 * b
+    z = (0.0193 * r + 0.1192 * g + 0.9505 * b) / 1.08883
+    return (116.0 * lab_f(y) - 16.0, 500.0 * (lab_f(x) - lab_f(y)), 200.0 * (lab_f(y) - lab_f(z)))
+
+
+def nearest_color(rgb):
+    lab = rgb_to_lab(*rgb)
+    distances = [math.dist(lab, rgb_to_lab(*color)) for color in DITHER_PALETTE]
+    return distances.index(min(distances))
+
+
+def map_color(color):
+    if color in COLOR_MAP:
+        return COLOR_MAP[color]
+    return nearest_color(((color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF))
+
+
+def convert(data):
+    offset = struct.unpack_from("<I", data, 10)[0]
+    headersize = struct.unpack_from("<I", data, 14)[0]
+    width, height = struct.unpack_from("<ii", data, 18)
+    bpp, compression = struct.unpack_from("<HI", data, 28)
+    colors = struct.unpack_from("<I", data, 46)[0]
+    if (width, height, bpp, compression) != (EPD_WIDTH, EPD_HEIGHT, 4, 0):
+        raise ValueError("need a 600 x 448 pixel 4bpp uncompressed bottom-up bitmap")
+    # Palette follows the DIB header, it may have less than 16 colors
+    if colors == 0 or colors > 16:
+        colors = 16
+    colors = min(colors, (offset - 14 - headersize) // 4)
+    palette = [struct.unpack_from("<I", data, 14 + headersize + 4 * i)[0] & 0x00FFFFFF for i in range(colors)]
+    lut = [map_color(c) for c in palette] + [EPD_BLACK] * (16 - colors)
+    # Same as the reader: both nibbles mapped and swapped, line reversed
+    row_lut = [(lut[b & 0x0F] << 4) | lut[b >> 4] for b in range(256)]
+    bytesperline = EPD_WIDTH // 2
+    out = bytearray()
+    for y in range(EPD_HEIGHT):
+        row = data[offset + y * bytesperline: offset + (y + 1) * bytesperline]
+        out += bytes(row_lut[b] for b in reversed(row))
+    return out
+
+
+def to_c_array(name, data):
+    lines = ["static const unsigned char %s[%iUL] = {" % (name, len(data))]
+    for i in range(0, len(data), 32):
+        lines.append("  " + ", ".join("0x%02X" % b for b in data[i:i + 32]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main(args):
+    if len(args) < 2 or len(args) % 2:
+        print(__doc__, file=sys.stderr)
+        return 1
+    print("//This stores the images we can display if no sd-card is usable")
+    print("//Data is already in display format (600 x 448 pixel, 2 pixel per byte,")
+    print("//mirrored as the display expects it), created with bmp2epd.py")
+    for i in range(0, len(args), 2):
+        with open(args[i], "rb") as f:
+            print()
+            print(to_c_array(args[i + 1], convert(f.read())))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
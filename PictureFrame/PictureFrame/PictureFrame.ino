@@ -74,6 +74,9 @@ for Linux.
 #include "epd5in65f.h"
 #include "sdhelper.h"
 #include "bmpreader.h"
+#include "shuffle.h"
+#include "imgcache.h"
+#include "esp_rom_crc.h"
 #include "images.h"
 /* Here you find the pin definitions for the board */
 #define epd_DIN   35
@@ -112,17 +115,94 @@ for Linux.
 #define SLEEP_TIME_1h  (3600000000ULL)
 #define SLEEP_TIME_1d (86400000000ULL)
 
+/* The monitor task ends a boot that takes longer than this with a short deep sleep */
+#define MONITOR_TIMEOUT_MS 60000
+
 #define DBGPRINT Serial1
 
+/* 
+  true: the SPI clock of the display is calibrated once and kept in the
+  preferences (epd_spi_hz), after a failed refresh the next slower clock
+  of the calibration list is kept. The calibration only sees BUSY, not 
+  corrupted pixels, so check the first images before turning it on.
+  With false the default clock of the Epd class is used
+*/
+#define EPD_SPI_AUTOCALIBRATE false
+
+/* 
+  true: the images are shown in a random order, every image once per 
+  cycle and a new order for every cycle. false: directory order
+*/
+#define SHUFFLE_IMAGES true
+
+/* 
+  true: the next images are decoded in one card session into the cache 
+  partition in the internal flash (see partitions.csv) and shown from 
+  there, the card is only powered when the cache is used up. That boot
+  shows its image from the card first and fills the cache with the time
+  left, at most IMAGE_CACHE_SLOTS images and only up to the end of the
+  cycle. Filling stops (also inside an image) IMAGE_CACHE_MARGIN_MS 
+  before the monitor task ends the boot, time for the state checkpoint
+  and to power the card off. Without the partition the card is read 
+  every boot
+*/
+#define IMAGE_CACHE           true
+#define IMAGE_CACHE_SLOTS     14
+#define IMAGE_CACHE_MARGIN_MS 3000
+
+/* 
+  Modes to mount the card, fastest first. 4 bit modes are only tried if
+  SD_D1 and SD_D2 are wired. The mode that worked is kept in the 
+  preferences (sd_mode) and tried first next time, if it fails the 
+  slower ones follow. A failed attempt is never answered with a format, 
+  the card is powered off for SD_POWER_OFF_MS before the next one
+*/
+typedef struct {
+  bool mode1bit;
+  int frequency;    //kHz
+} sd_mode_t;
+
+const sd_mode_t sd_modes[] = {
+  { false, SDMMC_FREQ_HIGHSPEED },
+  { false, SDMMC_FREQ_DEFAULT },
+  { true,  SDMMC_FREQ_HIGHSPEED },
+  { true,  SDMMC_FREQ_DEFAULT },
+  { true,  10000 }
+};
+#define SD_MODE_COUNT (sizeof(sd_modes)/sizeof(sd_modes[0]))
+#define SD_POWER_UP_MS  150
+#define SD_POWER_OFF_MS 50
+
 /* LC709203 gas gauge */
 Adafruit_LC709203F lc;
 
-//RTC_DATA_ATTR uint32_t image_idx = 0;
+/* 
+  State of the frame, kept in RTC memory over deep sleep. It is written
+  to the preferences only every STATE_CHECKPOINT_BOOTS boots and before 
+  the battery is empty, after a power loss the last checkpoint is used
+*/
+#define STATE_MAGIC             0x53544652UL
+#define STATE_CHECKPOINT_BOOTS  16
+
+typedef struct {
+  uint32_t magic;
+  uint32_t index;          //position in the current cycle
+  uint32_t shuffle_seed;   //order of the current cycle
+  uint32_t frame_hash;     //hash of the frame on the display, 0 unknown
+  uint32_t file_hash;      //hash of the identity of the file shown, 0 none
+  uint32_t boots;
+  uint32_t refreshes;
+  uint32_t skipped;        //refreshes skipped as the frame was on the display
+  uint32_t unsaved;        //boots since the last checkpoint
+  uint32_t cache_next;     //next slot of the image cache to show
+  uint32_t cache_count;    //slots filled in the last card session
+  uint32_t crc;
+} frame_state_t;
+
+RTC_DATA_ATTR frame_state_t state;
 
 
 Preferences preferences;
-/* We need an image buffer and assume a 600*448 pixel 4bpp image and display */
-uint8_t * imagebuffer_ptr = NULL;
 
 Epd epd(&SPI,epd_DIN, epd_CS, epd_CLK, epd_RST, epd_DC, epd_BUSY );
 
@@ -135,16 +215,45 @@ float   voltage;
 battery_t battery;
 
 TaskHandle_t MonitorTaskHandle = NULL;
+uint32_t monitor_start = 0;   //millis() when the monitor task was started
+
+/* 
+  Hash of the identity (name, size, date) of the image file that is decoded 
+  now, it is stored with the frame hash after a refresh. Is the next file 
+  the same or gives the same frame the refresh is skipped. 0 for none
+*/
+uint32_t frame_file_hash = 0;
+bool frame_on_display = false;
+
+/* Cache partition, NULL if there is none */
+const esp_partition_t* image_cache = NULL;
 
 /* Function prototypes */
 void setup_gpio ( void );
 bool setup_sdmmc( void );
+bool mount_sdmmc( const sd_mode_t* mode );
 bool end_sdmmc(void );
 void SDCardPower(bool);
 void set_next_idx(uint32_t);
 uint32_t get_current_idx( void );
-void read_image_sdcard( void );
+bool read_image_sdcard( void );
+bool next_image_file( String path, String &filename );
+uint32_t card_fingerprint( void );
+bool image_cache_ready( void );
+bool refill_image_cache( void );
+bool show_cached_image( void );
+String file_identity( File &file );
+uint32_t image_at( uint32_t idx, uint32_t count );
+uint32_t identity_hash( String identity );
+uint32_t state_crc( const frame_state_t* st );
+void state_changed( void );
+void state_load( void );
+void state_checkpoint( bool force );
+bool loadnextimage( void );
+bool update_display( void );
+void show_flash_image( const uint8_t* );
 void init_display ( void);
+bool wake_display( void );
 void entersleep( void );
 void entersleepinf( void );
 
@@ -157,7 +266,7 @@ void tskMonitor(void *arg){
   //Monitor Task, will be used to set the display to sleep
   //We will sleep for 60 seconds and then pu the system in sleep again
   while(1==1){
-    delay(60000);
+    delay(MONITOR_TIMEOUT_MS);
     DBGPRINT.print("Sleep by MonitorTask");
     //As we assume something went wrong we only seep for a minute
     if( HIGH == digitalRead(LP_DISABLE_IN) ) {
@@ -192,6 +301,7 @@ void entersleep( void ){
      delay(1000);
   } 
   //If we end here we will try to sleep for a while 
+  state_checkpoint(false);
   DBGPRINT.println("Enter ESP32-S3 1 day deep sleep mode");
   DBGPRINT.flush();
   esp_sleep_enable_timer_wakeup( SLEEP_TIME_1d ); //24 hours
@@ -210,6 +320,8 @@ void entersleepinf( ){
      DBGPRINT.print("Inf Sleep disable by LP_DISABLE_IN");
      delay(1000);
   } 
+  //We may not wake up before the battery is empty
+  state_checkpoint(true);
   DBGPRINT.println("Enter ESP32-S3 infinite deep sleep mode");
   DBGPRINT.flush();
   esp_sleep_enable_timer_wakeup( 30*SLEEP_TIME_1d ); //1 month hours
@@ -236,6 +348,29 @@ void setup_gpio( ){
 
 }
 
+/*-----------------------------------------
+Function  : mount_sdmmc 
+Input     : const sd_mode_t*
+Output    : bool
+Remarks   : mounts the card in one mode,
+            the card is not formated if this 
+            fails
+-------------------------------------------*/
+bool mount_sdmmc( const sd_mode_t* mode ){
+  uint32_t start = millis();
+  if(!SD_MMC.begin("/sdcard", mode->mode1bit, false, mode->frequency, 5)){
+    DBGPRINT.printf("Card Mount Failed (%i bit, %i kHz)\n\r", (true == mode->mode1bit) ? 1 : 4, mode->frequency);
+    return false;
+  }
+  if(CARD_NONE == SD_MMC.cardType()){
+    DBGPRINT.println("No SD_MMC card attached");
+    SD_MMC.end();
+    return false;
+  } 
+  DBGPRINT.printf("Card mounted with %i bit, %i kHz in %u ms\n\r", (true == mode->mode1bit) ? 1 : 4, mode->frequency, millis()-start);
+  return true;
+}
+
 /*-----------------------------------------
 Function  : setup_sdmmc 
 Input     : none
@@ -250,21 +385,38 @@ bool setup_sdmmc( void ){
     DBGPRINT.println("SD/MMC Pin setup failed");
     return false;
   } else {
-    delay(150); //Card need some time to initalize
-    //We now can try to mount the sd-card (20MHz 1bit mode)
-    if(!SD_MMC.begin("/sdcard", true, true, 20000, 5)){
-          Serial.println("Card Mount Failed");
-          return false;
+    delay(SD_POWER_UP_MS); //Card need some time to initalize
+    bool wide = ( (SD_D1 >= 0) && (SD_D2 >= 0) );
+    uint32_t first = preferences.getUChar("sd_mode", 0);
+    if(first >= SD_MODE_COUNT){
+      first = 0;
+    }
+    //The last mode that worked first, than all slower ones
+    bool tried = false;
+    for(uint32_t i=first;i<SD_MODE_COUNT;i++){
+      if( (false == sd_modes[i].mode1bit) && (false == wide) ){
+        continue;
+      }
+      if(true == tried){
+        //The failed attempt may have left the card half initialised
+        SDCardPower(false);
+        delay(SD_POWER_OFF_MS);
+        SDCardPower(true);
+        delay(SD_POWER_UP_MS);
+      }
+      tried = true;
+      if(true == mount_sdmmc(&sd_modes[i])){
+        if(i != first){
+          preferences.putUChar("sd_mode", i);
+        }
+        uint64_t cardSize = SD_MMC.cardSize() / (1024 * 1024);
+        DBGPRINT.printf("SD Card Size: %lluMB\n", cardSize);
+        return true;
       }
-      uint8_t cardType = SD_MMC.cardType();
-
-      if(cardType == CARD_NONE){
-          Serial.println("No SD_MMC card attached");
-          return false;
-      } 
-      uint64_t cardSize = SD_MMC.cardSize() / (1024 * 1024);
-      DBGPRINT.printf("SD Card Size: %lluMB\n", cardSize);
-      return true;
+    }
+    //Nothing worked, next time we start with the fastest mode again
+    preferences.remove("sd_mode");
+    return false;
   }
 
 }
@@ -291,72 +443,94 @@ void SDCardPower(bool enable ){
 
 /*-----------------------------------------
 Function  : update_display 
-Input     : uint8_t* imgptr
-Output    : none
-Remarks   : User needs to provide buffer
-            with image 
+Input     : none
+Output    : bool
+Remarks   : Image needs to be transfered
+            to the display before
 -------------------------------------------*/
-void update_display(uint8_t* imgptr){
+bool update_display( void ){
+  uint32_t hash = epd.EPD_5IN65F_FrameHash();
+  if( (true == frame_on_display) || 
+      ( (0 != hash) && (hash == state.frame_hash) ) ){
+    DBGPRINT.printf("Frame %08x is already on the display, skip refresh\n\r", hash);
+    state.skipped++;
+    state_changed();
+    return true;
+  }
   DBGPRINT.println("Write new image");
-  epd.EPD_5IN65F_Display(imgptr);
+  //If the refresh fails we don't know what is on the display
+  state.frame_hash = 0;
+  state.file_hash = 0;
+  state_changed();
+  if(EPD_OK != epd.EPD_5IN65F_Refresh()){
+    DBGPRINT.println("Display refresh failed");
+    #if EPD_SPI_AUTOCALIBRATE
+    //A new calibration would take the same clock again
+    uint32_t spi_hz = Epd::SlowerSPIFrequency(epd.GetSPIFrequency());
+    DBGPRINT.printf("SPI clock lowered to %u kHz\n\r", spi_hz/1000);
+    preferences.putULong("epd_spi_hz", spi_hz);
+    #endif
+    return false;
+  }
+  state.frame_hash = hash;
+  state.file_hash = frame_file_hash;
+  state.refreshes++;
+  state_changed();
+  return true;
 }
 
 /*-----------------------------------------
-Function  : loadnextimage 
-Input     : uint8_t* imgptr
+Function  : show_flash_image 
+Input     : const uint8_t* imgptr
 Output    : none
-Remarks   : User needs to provide buffer
-            with image size bytes
+Remarks   : Image from images.h is already in
+            display format and send directly
+            from flash, display needs to be awake
 -------------------------------------------*/
-void loadnextimage(uint8_t* imgptr){
+void show_flash_image( const uint8_t* imgptr ){
+  epd.EPD_5IN65F_BeginImage();
+  epd.EPD_5IN65F_SendImageData(imgptr, (EPD_WIDTH/2)*EPD_HEIGHT);
+}
+
+/*-----------------------------------------
+Function  : loadnextimage 
+Input     : none
+Output    : bool
+Remarks   : Display needs to be awake, the
+            image is streamed to the display
+-------------------------------------------*/
+bool loadnextimage( void ){
   
   
-  if(false == read_image_sdcard(imgptr)){
+  if(false == read_image_sdcard()){
     //We load a dummy image from flash here
-    
+    DBGPRINT.println("Use fallback image from flash");
+    frame_file_hash = 0;
+    show_flash_image(_acNo_Sd_Card);
+    return false;
   } 
+  return true;
 }
 
-bool read_image_sdcard(uint8_t* img_ptr ){
-  //we get a listing of all files on the image folder
-  //and we than will open one by index if it is a bmp
-  //we expect those to be in /images on the card
-  uint32_t index = get_current_idx();
+bool read_image_sdcard( void ){
+  //The images are expected in /images on the card, an index of the 
+  //bitmaps there is kept in /images/.index and build again if the 
+  //card has changed or all images were shown
   String path = "/images";
   String filename = "";
   bool result = false;
   
-  File file = openFileAtIdx(SD_MMC,path.c_str(),index);
-  if(!file){
-    DBGPRINT.printf("Failed to open image at idx %i \r\n",index);
-    index=0;    
-    DBGPRINT.printf("Try to open image at idx %i \r\n",index);
-    File file = openFileAtIdx(SD_MMC,path.c_str(),0);
-    index++;
-    if(!file){
-      DBGPRINT.printf("Can't read image at idx %i \r\n",index);
-      DBGPRINT.printf("Giving up for now.....");
-      index=0;
-      result = false;
-      filename="";      
-    } else {
-      filename = String(file.name());
-      file.close();  
-    }       
-    set_next_idx(index);
-  } else {
-    index++;
-    set_next_idx(index);
-    filename = String(file.name());
-    file.close();
-  }
- 
-  if(filename != ""){ //We can try to read the file    
-    result =  load_bitmap_for_epd(SD_MMC, path,filename, img_ptr);
-  } else {
+  if(false == next_image_file(path, filename)){
     //We have no file to open  
     DBGPRINT.printf("File == NULL\n\r");
     result = false;           
+  } else if(frame_file_hash == state.file_hash){
+    //Same file as last time, nothing to read and nothing to refresh
+    DBGPRINT.printf("%s is already on the display\n\r", filename.c_str());
+    frame_on_display = true;
+    result = true;
+  } else { //We can try to read the file    
+    result =  load_bitmap_for_epd(SD_MMC, path,filename, epd);
   }
   return result;
   
@@ -364,29 +538,332 @@ bool read_image_sdcard(uint8_t* img_ptr ){
 
 }
 
+/*-----------------------------------------
+Function  : next_image_file 
+Input     : String, String&
+Output    : bool
+Remarks   : name of the next image in path,
+            moves on in the cycle and sets
+            frame_file_hash, card needs to 
+            be mounted
+-------------------------------------------*/
+bool next_image_file( String path, String &filename ){
+  uint32_t index = get_current_idx();
+  uint32_t count = openImageIndex(SD_MMC, path.c_str(), false, card_fingerprint);
+  if(index >= count){
+    DBGPRINT.printf("All %u images shown, start again\r\n", count);
+    index = 0;
+    count = openImageIndex(SD_MMC, path.c_str(), true, card_fingerprint);
+    #if SHUFFLE_IMAGES
+    state.shuffle_seed = esp_random();
+    state_changed();
+    #endif
+  }
+  File file = openImageAtIdx(SD_MMC, path.c_str(), image_at(index, count));
+  if( (!file) && (count > 0) ){
+    //An image is gone or has changed, the index is out of date
+    DBGPRINT.printf("Failed to open image at idx %i, rebuild index \r\n", index);
+    count = openImageIndex(SD_MMC, path.c_str(), true, card_fingerprint);
+    if(index >= count){
+      index = 0;
+    }
+    file = openImageAtIdx(SD_MMC, path.c_str(), image_at(index, count));
+  }
+  if(!file){
+    DBGPRINT.printf("Can't read image at idx %i \r\n", index);
+    DBGPRINT.printf("Giving up for now.....");
+    set_next_idx(0);
+    frame_file_hash = 0;
+    return false;
+  }
+  set_next_idx(index+1);
+  filename = String(file.name());
+  frame_file_hash = identity_hash(file_identity(file));
+  file.close();
+  return true;
+}
+
+/*-----------------------------------------
+Function  : card_fingerprint 
+Input     : none
+Output    : uint32_t
+Remarks   : used space of the card in KB,
+            changes with nearly every file 
+            that is added, removed or written.
+            A file replaced by one with the same
+            number of clusters is found when it
+            fails to open or at the end of the 
+            cycle, card needs to be mounted
+-------------------------------------------*/
+uint32_t card_fingerprint( void ){
+  return (uint32_t)(SD_MMC.usedBytes()/1024);
+}
+
+/*-----------------------------------------
+Function  : image_cache_ready 
+Input     : none
+Output    : bool
+Remarks   : true if the cache has an image
+            that was not shown yet
+-------------------------------------------*/
+bool image_cache_ready( void ){
+  return (NULL != image_cache) && (state.cache_next < state.cache_count);
+}
+
+/*-----------------------------------------
+Function  : refill_image_cache 
+Input     : none
+Output    : bool
+Remarks   : decodes the next images of the
+            cycle into the cache until the
+            monitor deadline or the end of the
+            cycle, card needs to be mounted
+-------------------------------------------*/
+bool refill_image_cache( void ){
+  uint32_t slots = imgcache_slots(image_cache);
+  if(slots > IMAGE_CACHE_SLOTS){
+    slots = IMAGE_CACHE_SLOTS;
+  }
+  if(0 == slots){
+    return false;
+  }
+  uint32_t start = millis();
+  //Never 0, that is no deadline for the reader
+  uint32_t deadline = (monitor_start+MONITOR_TIMEOUT_MS-IMAGE_CACHE_MARGIN_MS) | 1;
+  String path = "/images";
+  state.cache_next = 0;
+  state.cache_count = 0;
+  state_changed();
+  //A file that can't be decoded is skipped like on the direct path, 
+  //the attempts are limited in case none of them can
+  for(uint32_t attempt=0;attempt<2*slots;attempt++){
+    if( (state.cache_count >= slots) || ((int32_t)(millis()-deadline) >= 0) ){
+      break;
+    }
+    //The next cycle is started by the boot that reads the card again, a
+    //wrap here would build the index again and cache images twice
+    if(get_current_idx() >= openImageIndex(SD_MMC, path.c_str(), false, card_fingerprint)){
+      break;
+    }
+    String filename = "";
+    if(false == next_image_file(path, filename)){
+      break;
+    }
+    if(true == imgcache_store(image_cache, state.cache_count, SD_MMC, path, filename, frame_file_hash, deadline)){
+      state.cache_count++;
+      state_changed();
+    } else if((int32_t)(millis()-deadline) >= 0){
+      //Cut off by the deadline, the image is the first one next time
+      set_next_idx(get_current_idx()-1);
+      break;
+    }
+  }
+  DBGPRINT.printf("%u images cached in %u ms\r\n", state.cache_count, millis()-start);
+  //Index and cache need to match after a power loss
+  state_checkpoint(true);
+  return (state.cache_count > 0);
+}
+
+/*-----------------------------------------
+Function  : show_cached_image 
+Input     : none
+Output    : bool
+Remarks   : Display needs to be awake, the
+            next image of the cache is send
+            to the display
+-------------------------------------------*/
+bool show_cached_image( void ){
+  uint32_t slot = state.cache_next;
+  image_cache_header_t header;
+  //Moved on first, a slot that breaks the boot is not tried again
+  state.cache_next++;
+  state_changed();
+  if(false == imgcache_header(image_cache, slot, &header)){
+    state.cache_count = 0;
+    state_changed();
+    return false;
+  }
+  frame_file_hash = header.file_hash;
+  //The same file or another one with the same frame, nothing to send
+  if( (frame_file_hash == state.file_hash) || 
+      ( (0 != header.frame_hash) && (header.frame_hash == state.frame_hash) ) ){
+    DBGPRINT.printf("Cached image %u is already on the display\n\r", slot);
+    frame_on_display = true;
+    return true;
+  }
+  if(false == imgcache_send(image_cache, slot, epd)){
+    //The frame is not refreshed, the cache is filled again next boot
+    frame_file_hash = 0;
+    state.cache_count = 0;
+    state_changed();
+    return false;
+  }
+  return true;
+}
+
+/*-----------------------------------------
+Function  : image_at 
+Input     : uint32_t, uint32_t
+Output    : uint32_t
+Remarks   : image in the index shown at 
+            position idx of the cycle, with
+            SHUFFLE_IMAGES a random order is
+            used that changes every cycle
+-------------------------------------------*/
+uint32_t image_at( uint32_t idx, uint32_t count ){
+  #if SHUFFLE_IMAGES
+  uint32_t image = shuffle_index(idx, count, state.shuffle_seed);
+  DBGPRINT.printf("Position %u of %u is image %u \r\n", idx, count, image);
+  return image;
+  #else
+  return idx;
+  #endif
+}
+
+/*-----------------------------------------
+Function  : file_identity 
+Input     : File&
+Output    : String
+Remarks   : name, size and date of a file, 
+            used to see if the same file is
+            shown again
+-------------------------------------------*/
+String file_identity( File &file ){
+  return String(file.name()) + ":" + String((unsigned long)file.size()) + ":" + String((unsigned long)file.getLastWrite());
+}
+
 void set_next_idx( uint32_t idx){
-  //image_idx =idx; //Move data into RTC RAM
-  preferences.putULong("counter", idx);
+  state.index = idx;
+  state_changed();
   DBGPRINT.printf("Set image idx %i \r\n", idx);
 }
 
 uint32_t get_current_idx( void ){
-  //uint32_t idx = image_idx;
-  uint32_t idx = preferences.getULong("counter",0);
+  uint32_t idx = state.index;
   DBGPRINT.printf("Get image idx %i \r\n", idx);
   return idx;
 }
 
+/*-----------------------------------------
+Function  : identity_hash 
+Input     : String
+Output    : uint32_t
+Remarks   : FNV-1a of a file identity, 
+            never 0
+-------------------------------------------*/
+uint32_t identity_hash( String identity ){
+  uint32_t hash = EPD_FRAME_HASH_INIT;
+  for(const char* c = identity.c_str(); 0 != *c; c++){
+    hash = (hash ^ (uint8_t)(*c)) * EPD_FRAME_HASH_PRIME;
+  }
+  return (0 != hash) ? hash : 1;
+}
+
+/*-----------------------------------------
+Function  : state_crc 
+Input     : const frame_state_t*
+Output    : uint32_t
+Remarks   : CRC over everything but the crc
+-------------------------------------------*/
+uint32_t state_crc( const frame_state_t* st ){
+  return esp_rom_crc32_le(0, (const uint8_t*)st, offsetof(frame_state_t, crc));
+}
+
+/*-----------------------------------------
+Function  : state_changed 
+Input     : none
+Output    : none
+Remarks   : needs to be called after every
+            change of the state, keeps the
+            RTC copy valid
+-------------------------------------------*/
+void state_changed( void ){
+  state.crc = state_crc(&state);
+}
+
+/*-----------------------------------------
+Function  : state_load 
+Input     : none
+Output    : none
+Remarks   : uses the state in RTC memory if it
+            is valid, after a power loss the 
+            last checkpoint, preferences need 
+            to be open
+-------------------------------------------*/
+void state_load( void ){
+  if( (STATE_MAGIC != state.magic) || (state.crc != state_crc(&state)) ){
+    frame_state_t saved;
+    if( (sizeof(saved) == preferences.getBytes("state", &saved, sizeof(saved))) &&
+        (STATE_MAGIC == saved.magic) && (saved.crc == state_crc(&saved)) ){
+      DBGPRINT.println("State restored from checkpoint");
+      state = saved;
+    } else {
+      DBGPRINT.println("No saved state, start new");
+      memset(&state, 0, sizeof(state));
+      state.magic = STATE_MAGIC;
+      state.index = preferences.getULong("counter", 0); //Older versions
+    }
+    //The checkpoint may be older than the image on the display
+    state.frame_hash = 0;
+    state.file_hash = 0;
+  }
+  state.boots++;
+  state.unsaved++;
+  state_changed();
+  DBGPRINT.printf("Boot %u, %u refreshes, %u skipped\r\n", state.boots, state.refreshes, state.skipped);
+}
+
+/*-----------------------------------------
+Function  : state_checkpoint 
+Input     : bool
+Output    : none
+Remarks   : writes the state to the preferences
+            every STATE_CHECKPOINT_BOOTS boots or
+            if force is true
+-------------------------------------------*/
+void state_checkpoint( bool force ){
+  if( (true == force) || (state.unsaved >= STATE_CHECKPOINT_BOOTS) ){
+    state.unsaved = 0;
+    state_changed();
+    preferences.putBytes("state", &state, sizeof(state));
+    DBGPRINT.println("State checkpoint written");
+  }
+}
+
 void init_display ( void){
   DBGPRINT.print("Setup EPD SPI");
+  #if EPD_SPI_AUTOCALIBRATE
+  uint32_t spi_hz = preferences.getULong("epd_spi_hz", 0);
+  //Older firmware calibrated up to 20 MHz, these are done again
+  if(spi_hz > EPD_SPI_MAX_HZ){
+    preferences.remove("epd_spi_hz");
+    spi_hz = 0;
+  }
+  if(0 != spi_hz){
+    epd.SetSPIFrequency(spi_hz);
+  }
+  #endif
   epd.Init();
   DBGPRINT.print("Setup EPD SPI");  
 }
 
-void wake_display( void ){
+bool wake_display( void ){
   DBGPRINT.print("wakeup display");
-  epd.Wake();
+  if(EPD_OK != epd.Wake()){
+    DBGPRINT.println("Display not responding");
+    return false;
+  }
+  #if EPD_SPI_AUTOCALIBRATE
+  if(0 == preferences.getULong("epd_spi_hz", 0)){
+    DBGPRINT.println("Calibrate display SPI clock");
+    uint32_t spi_hz = epd.CalibrateSPI();
+    if(0 != spi_hz){
+      preferences.putULong("epd_spi_hz", spi_hz);
+    }
+  }
+  #endif
   DBGPRINT.print("wakeup done");
+  return true;
 }
 
 void setup() {
@@ -414,6 +891,8 @@ void setup() {
   }
 
   preferences.begin("imgframe", false);
+  state_load();
+  monitor_start = millis();
   xTaskCreate(tskMonitor, "Monitor Task", 4096, NULL, 10, &MonitorTaskHandle);
   DBGPRINT.println("Setup GPIO");
   setup_gpio();
@@ -421,29 +900,8 @@ void setup() {
   /* At this point we need to decide what we do:
   - If we have more than 10% within the battery we will load the next image
   - If we have 10% and below we will display a battery empty image and after sleep infinite
+  There is no image buffer, every image is read line by line and streamed to the display
   */
-  if(ESP.getPsramSize()> (600*448/2) ){
-    //Next is to get an image buffer with 600*448*4Bit = 144000 byte from psram 
-    //This will be slower than getting some heap but also give more headroom for 
-    //other parts that need some buffer like the sd-card reading
-    imagebuffer_ptr = (byte*)ps_malloc( (600*448/2) );
-
-
-  } else if( ESP.getFreeHeap() > (600*448/2) ){
-    //This is not the good way to go as we eat up heap as it would be free....
-    imagebuffer_ptr = (uint8_t*)malloc( (600*448/2) );  
-    DBGPRINT.println("NO PSRAM use now internal RAM");      
-   }
-
-  if(imagebuffer_ptr == NULL ){
-    //Memory allocation failed ...
-    epd.Init();
-    epd.Wake();
-    epd.Clear(EPD_5IN65F_RED);
-    epd.Sleep();
-  } else {
-    //We are good to go 
-  }
   
   DBGPRINT.printf("Battery charge %f %\n\r",battery.percent);
   DBGPRINT.printf("Cell Voltage %f V\n\r",battery.voltage);
@@ -452,33 +910,59 @@ void setup() {
   } else { 
     if ( (battery.percent<5) ){
       //Display empty symbol and do a long sleep ( as long as possible )
-      load_bitmap_for_epd_array((uint8_t*)_acBatteryEmpty,imagebuffer_ptr);
       init_display();
-      wake_display();
-      update_display(imagebuffer_ptr);
+      if(true == wake_display()){
+        show_flash_image(_acBatteryEmpty);
+        update_display();
+      }
       epd.Sleep();
       entersleepinf();  //Sleep forever....
     } 
   }
   
   DBGPRINT.println("Setup SD/MMC");
-  if(true == setup_sdmmc() ){
-    DBGPRINT.println("Load BMP");
-    loadnextimage(imagebuffer_ptr);
-    DBGPRINT.println("Image loaded into RAM");
+  #if IMAGE_CACHE
+  image_cache = imgcache_partition();
+  if(true == image_cache_ready()){
+    //Image comes from the internal flash, the card stays unpowered
+    init_display();
+    if(true == wake_display()){
+      DBGPRINT.println("Load cached image");
+      if(true == show_cached_image()){
+        update_display();
+      }
+    }
+    epd.Sleep();
+    entersleep(); //Sleep for 24 hours
+  }
+  #endif
+  bool sd_mounted = setup_sdmmc();
+  if(true == sd_mounted ){
     DBGPRINT.println("Init Display");
     init_display();
-    wake_display();
-    DBGPRINT.println("Update Display");    
-    update_display(imagebuffer_ptr);
+    if(true == wake_display()){
+      DBGPRINT.println("Load BMP");
+      loadnextimage();
+      DBGPRINT.println("Image send to display");
+      DBGPRINT.println("Update Display");    
+      update_display();
+    }
     DBGPRINT.println("Update done, send display to sleep");
     epd.Sleep();
+    #if IMAGE_CACHE
+    //Cache is used up, it is filled for the next days with the time left
+    //in this card session, the image of today is already on the display
+    if(NULL != image_cache){
+      refill_image_cache();
+    }
+    #endif
     entersleep(); //Sleep for 24 hours
   } else {
-    load_bitmap_for_epd_array((uint8_t*)_acNo_Sd_Card,imagebuffer_ptr);
     init_display();
-    wake_display();
-    update_display(imagebuffer_ptr);
+    if(true == wake_display()){
+      show_flash_image(_acNo_Sd_Card);
+      update_display();
+    }
     epd.Sleep();
     entersleep(); //Sleep for 24 hours
   }
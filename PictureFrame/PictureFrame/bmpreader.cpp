@@ -1,4 +1,10 @@
 #include "bmpreader.h"
+#include "dither.h"
+#include "scaler.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 
 #define BMP_COMP_BI_RGB             0
 #define BMP_COMP_BI_RLE8            1
@@ -13,6 +19,43 @@
 
 #define DBGPRINT Serial1
 
+/* Compressed data is read in chunks of this size from the card */
+#define BMP_READ_CHUNK_SIZE 512
+
+/* Larger images are scaled down, this limits the size of one line in RAM */
+#define BMP_MAX_WIDTH 8192
+#define BMP_MAX_HEIGHT 8192
+
+/* 
+  448 x 600 images are rotated for a frame hung in portrait, 90 turns the 
+  image clockwise, 270 counterclockwise. Rotation is done in bands of 
+  display lines that fit into internal RAM, one band needs ~19 KB 
+*/
+#define BMP_PORTRAIT_ROTATION 90
+#define BMP_ROTATE_BAND_LINES 64
+#define BMP_ROTATE_TILE 8
+
+/* 
+  Decoding runs in its own task on the other core while the caller sends
+  the finished lines to the display, blocks of this many lines are passed
+  between both, two blocks (~9 KB) are in internal RAM. The blocks are 
+  send CPU driven with SPI.writeBytes(), they need no DMA capable memory
+*/
+#define BMP_PIPELINE_LINES 16
+#define BMP_PIPELINE_STACK 12288
+#define BMP_PIPELINE_PRIO 5
+#define BMP_PIPELINE_CORE 0
+
+/* 
+  true: top-down files are read forward and send top line first with the
+  gate scan of the panel turned (EPD_PSR_UD). This is only verified on 
+  the host model of the controller, by default they are read bottom line
+  first with one seek per line
+*/
+#ifndef BMP_TOPDOWN_SCAN
+#define BMP_TOPDOWN_SCAN false
+#endif
+
 typedef struct __attribute__((__packed__)){
   char id[2];
   uint32_t FileSize;
@@ -24,7 +67,7 @@ typedef struct __attribute__((__packed__)){
 typedef struct __attribute__((__packed__)){
   uint32_t headersize;
   uint32_t imgwidth;
-  uint32_t imgheight;
+  int32_t imgheight;      //negative for top-down images
   uint16_t bitplanes;     
   uint16_t bitperpixel;
   uint32_t compression;
@@ -70,6 +113,13 @@ typedef struct{
 */
 color_lut_entry_t color_lut[16];
 
+/* 
+  Byte to byte table build from color_lut, input is one byte with two 
+  palette indices, output are the two display colors already swapped 
+  so a line can be mirrored by just reversing the byte order
+*/
+static uint8_t row_lut[256];
+
 #define epd_black 0x00
 #define epd_white 0x01
 #define epd_green 0x02
@@ -86,53 +136,27 @@ color_lut_entry_t color_lut[16];
 #define rgb_blue (0x003f48cc)
 #define rgb_transparent (0x00ffe282)
 #define rgb_white (0x00ffffff)
+#define rgb_orange (0x00ff7f27)
 
 
 
-bool load_bitmap_for_epd(fs::FS &fs, String path, String filename, uint8_t* buffer){
-    // If we could open a file we will print some debug information
-    uint32_t start = millis();    
-    File file = fs.open(path+"/"+filename);
-    if(!file){
-      DBGPRINT.println("Reader can't open file");
-      return false;
-    }
-    DBGPRINT.print("  FILE returned: ");
-    DBGPRINT.print(file.name());
-    DBGPRINT.print("  SIZE: ");
-    DBGPRINT.println(file.size());
-
-    //Next is to load the BMP/DIB header
-    BMP_Header_t BMPHeader;
-    DIB_Header_t DIBHeader;
-    BMP_Color_Pallette16_t Palette;
-    file.readBytes((char*)(&BMPHeader), sizeof(BMPHeader));
-    DBGPRINT.printf("Header id %c %c\n\r",BMPHeader.id[0],BMPHeader.id[1]);
-    DBGPRINT.printf("Filesize = %i\n\r", BMPHeader.FileSize);
-    DBGPRINT.printf("Data offset = %i\n\r", BMPHeader.ImageDataOffset);
-    file.readBytes((char*)(&DIBHeader), sizeof(DIBHeader));
-    DBGPRINT.printf("Image width %i\n\r", DIBHeader.imgwidth);
-    DBGPRINT.printf("Image height %i\n\r", DIBHeader.imgheight);
-    DBGPRINT.printf("Bitperpixel %i\n\r", DIBHeader.bitperpixel); //if this is less than 8 we have a color palette 
-    //Next is to read the plattet depeding on the bits per pixel
-    //1 bit per pixel means 2 entries
-    //4 bit per pixel means 16 entry
-    //8 bit per pixel means 256 entry
-    if(DIBHeader.bitperpixel!=4){ //May support later 1bpp images?
-      DBGPRINT.println("We can only process 4 bit per pixel for now");
-      file.close();
-      return false;
-    }
-    file.readBytes((char*)(&Palette), sizeof(Palette));
+/*-----------------------------------------
+Function  : setup_color_lut
+Input     : BMP_Color_Pallette16_t*
+Output    : none
+Remarks   : maps the bitmap palette to the 
+            display colors
+-------------------------------------------*/
+static void setup_color_lut(BMP_Color_Pallette16_t* Palette){
     for(uint32_t i=0;i<16;i++){
       DBGPRINT.printf("Color entry %i\n\r", i);
-      DBGPRINT.printf("Color dword 0x%08x -> ",Palette.entry[i].colordword );
-      DBGPRINT.printf("R: [ 0x%02x / %i ] ",Palette.entry[i].color.r, Palette.entry[i].color.r  );      
-      DBGPRINT.printf("G: [ 0x%02x / %i ] ",Palette.entry[i].color.g, Palette.entry[i].color.g );      
-      DBGPRINT.printf("B: [ 0x%02x / %i ]\n\r",Palette.entry[i].color.b, Palette.entry[i].color.b );      
+      DBGPRINT.printf("Color dword 0x%08x -> ",Palette->entry[i].colordword );
+      DBGPRINT.printf("R: [ 0x%02x / %i ] ",Palette->entry[i].color.r, Palette->entry[i].color.r  );      
+      DBGPRINT.printf("G: [ 0x%02x / %i ] ",Palette->entry[i].color.g, Palette->entry[i].color.g );      
+      DBGPRINT.printf("B: [ 0x%02x / %i ] ",Palette->entry[i].color.b, Palette->entry[i].color.b );      
       
-      color_lut[i].input=Palette.entry[i].color;
-      switch (Palette.entry[i].colordword){
+      color_lut[i].input=Palette->entry[i].color;
+      switch (Palette->entry[i].colordword){
 
         case rgb_red:{
           color_lut[i].output=epd_red;        
@@ -162,223 +186,862 @@ bool load_bitmap_for_epd(fs::FS &fs, String path, String filename, uint8_t* buff
           color_lut[i].output=epd_white;
         }break;
 
+        case rgb_orange:{
+          color_lut[i].output=epd_orange;
+        }break;
+
         default:{
-          color_lut[i].output=epd_transparent;
+          //Not one of our conversion colors, use what looks closest on the panel
+          color_lut[i].output=dither_nearest_color(Palette->entry[i].color.r, Palette->entry[i].color.g, Palette->entry[i].color.b);
         }break;
 
       }
-      
+      DBGPRINT.printf("-> EPD color %i\n\r", color_lut[i].output);
+    }
+    //Both nibbles are mapped and swapped with one lookup later
+    for(uint32_t i=0;i<256;i++){
+      row_lut[i]= ( (color_lut[i&0x0F].output<<4) &0xF0) | (color_lut[(i>>4)&0x0F].output&0x0F);
+    }
+}
 
+/*-----------------------------------------
+Function  : check_bitmap_header
+Input     : BMP_Header_t*, DIB_Header_t*, uint32_t
+Output    : bool
+Remarks   : prints the header and checks if 
+            we can process the image and all
+            parts are inside the file
+-------------------------------------------*/
+static bool check_bitmap_header(BMP_Header_t* BMPHeader, DIB_Header_t* DIBHeader, uint32_t filesize){
+    DBGPRINT.printf("Header id %c %c\n\r",BMPHeader->id[0],BMPHeader->id[1]);
+    DBGPRINT.printf("Filesize = %i\n\r", BMPHeader->FileSize);
+    DBGPRINT.printf("Data offset = %i\n\r", BMPHeader->ImageDataOffset);
+    DBGPRINT.printf("Image width %i\n\r", DIBHeader->imgwidth);
+    DBGPRINT.printf("Image height %i\n\r", DIBHeader->imgheight);
+    DBGPRINT.printf("Bitperpixel %i\n\r", DIBHeader->bitperpixel); //if this is less than 8 we have a color palette 
+    DBGPRINT.printf("Compression %i\n\r", DIBHeader->compression);
+    //Next is to read the plattet depeding on the bits per pixel
+    //1 bit per pixel means 2 entries
+    //4 bit per pixel means 16 entry
+    //8 bit per pixel means 256 entry
+    //24 bit per pixel has no palette and will be dithered like 8 bit
+    if( (DIBHeader->bitperpixel!=4) && (DIBHeader->bitperpixel!=8) && (DIBHeader->bitperpixel!=24) ){ //May support later 1bpp images?
+      DBGPRINT.println("We can only process 4, 8 or 24 bit per pixel for now");
+      return false;
+    }
 
+    if( (DIBHeader->compression!=BMP_COMP_BI_RGB) && 
+        ( (DIBHeader->compression!=BMP_COMP_BI_RLE4) || (DIBHeader->bitperpixel!=4) ) ){
+      DBGPRINT.println("We can only process uncompressed or RLE4 images");
+      return false;
     }
 
+    //Images that are not 600 x 448 will be scaled to fit the display
+    if( (0 == DIBHeader->imgwidth) || (DIBHeader->imgwidth>BMP_MAX_WIDTH) ){
+      DBGPRINT.println("Width not supported");
+      return false;
+    }
 
-    
-    if(DIBHeader.imgwidth!=600){
-      DBGPRINT.println("With not 600\n\r");
-      file.close();
+    if( (0 == DIBHeader->imgheight) || (DIBHeader->imgheight>BMP_MAX_HEIGHT) || (DIBHeader->imgheight<-BMP_MAX_HEIGHT) ){
+      DBGPRINT.println("Height not supported");
       return false;
     }
 
-    if(DIBHeader.imgheight!=448){
-      DBGPRINT.println("Height != 448");
-      file.close();
+    //Top-down images can't be compressed
+    if( (DIBHeader->imgheight<0) && (DIBHeader->compression!=BMP_COMP_BI_RGB) ){
+      DBGPRINT.println("Top-down image must be uncompressed");
       return false;
     }
 
-    file.seek(BMPHeader.ImageDataOffset); //Jump to raw data and start reading.....
-    //we have only 7 ish colors so we map everything bejond color 7 as transparent (only  0 to 6 are valid colors)
-    //every byte holds 2 pixel, we read 300 bytes per line and 448 lines of data
-    file.readBytes((char*)(buffer),(BMPHeader.FileSize-BMPHeader.ImageDataOffset)); //We read all data at once into the buffer
-    file.close();   
+    //Palette is between the headers and the data
+    if( (DIBHeader->headersize<sizeof(DIB_Header_t)) || 
+        ( (sizeof(BMP_Header_t)+DIBHeader->headersize) > BMPHeader->ImageDataOffset) ||
+        (BMPHeader->ImageDataOffset>=filesize) ){
+      DBGPRINT.println("Header or data offset invalid");
+      return false;
+    }
 
-    //At this point we won't need the SD-Card any longer....
-    //We need to change color according to a color palette we have in RAM
-    uint32_t bytesperline = DIBHeader.imgwidth/2;
-    for(uint32_t x=0;x<(DIBHeader.imgheight);x++){  
-      for(uint32_t i=0;i<(bytesperline);i++){
-       
-        uint32_t offset = bytesperline*x;
-        
-        uint8_t pixel_a[2];
-        uint8_t pixel_b[2];
-        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
-        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
-        pixel_a[0]=color_lut[pixel_a[0]].output;
-        pixel_a[1]=color_lut[pixel_a[1]].output;
-        buffer[offset+i]= ( (pixel_a[0]<<4) &0xF0) | (pixel_a[1]&0x0F);
+    //We never read more than the lines need, missing lines end up white
+    if(DIBHeader->compression==BMP_COMP_BI_RGB){
+      uint32_t stride = ( ( (DIBHeader->imgwidth*DIBHeader->bitperpixel)+31 )/32 )*4;
+      uint32_t lines = (DIBHeader->imgheight<0) ? -DIBHeader->imgheight : DIBHeader->imgheight;
+      if( (filesize-BMPHeader->ImageDataOffset) < (stride*lines) ){
+        DBGPRINT.printf("Image data truncated, %i of %i bytes\n\r", filesize-BMPHeader->ImageDataOffset, stride*lines);
+      }
+    }
+    return true;
+}
 
-        
+/*-----------------------------------------
+Function  : convert_row
+Input     : uint8_t*, uint32_t
+Output    : none
+Remarks   : changes the colors of one line 
+            and mirrors it for the display
+-------------------------------------------*/
+static void convert_row(uint8_t* row, uint32_t bytesperline){
+    //Color change and mirroring are done in one pass, the swapped 
+    //nibbles from row_lut and the reversed byte order mirror the line
+    uint32_t i=0;
+    uint32_t j=bytesperline;
+    while(i<j){
+      j--;
+      uint8_t pixel_a = row_lut[row[i]];
+      uint8_t pixel_b = row_lut[row[j]];
+      row[j]=pixel_a;
+      row[i]=pixel_b;
+      i++;
+    }
+}
+
+/* Buffered access to the image data, used for compressed images */
+typedef struct{
+  File* file;
+  uint8_t data[BMP_READ_CHUNK_SIZE];
+  uint32_t fill;
+  uint32_t pos;
+  uint32_t bytesread;
+  uint32_t readtime;   //us spent reading from the card
+} bmp_stream_t;
+
+/* RLE4 decoder state that is kept from one line to the next */
+typedef struct{
+  bmp_stream_t* stream;
+  uint32_t skiplines;  //lines left empty by a delta
+  uint32_t startx;     //first pixel in the next line set by a delta
+  bool endofbitmap;
+  bool error;
+} rle4_state_t;
+
+/*-----------------------------------------
+Function  : stream_read
+Input     : bmp_stream_t*
+Output    : int16_t
+Remarks   : returns next byte or -1 if 
+            no more data is available
+-------------------------------------------*/
+static int16_t stream_read(bmp_stream_t* stream){
+    if(stream->pos>=stream->fill){
+      uint32_t start = micros();
+      stream->fill = stream->file->read(stream->data, sizeof(stream->data));
+      stream->readtime += micros()-start;
+      stream->pos = 0;
+      stream->bytesread += stream->fill;
+      if(0 == stream->fill){
+        return -1;
       }
     }
-    //image is color corrected in ram but we need also to mirror it vertically
-    
-    for(uint32_t x=0;x<(DIBHeader.imgheight);x++){  
-      for(uint32_t i=0;i<(bytesperline/2);i++){
-       
-        uint32_t offset = bytesperline*x;
-        
-        uint8_t pixel_a[2];
-        uint8_t pixel_b[2];
-        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
-        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
-        
-        pixel_b[0]=(buffer[offset+bytesperline-1-i]>>4)&0x0F;
-        pixel_b[1]=(buffer[offset+bytesperline-1-i]>>0)&0x0F;
-        
+    return stream->data[stream->pos++];
+}
 
-        
-        buffer[offset+bytesperline-1-i]= ( (pixel_a[1]<<4) &0xF0) | (pixel_a[0]&0x0F);
-        buffer[offset+i] = ( (pixel_b[1]<<4) &0xF0) | (pixel_b[0]&0x0F);
-        
+/*-----------------------------------------
+Function  : set_pixel
+Input     : uint8_t*, uint32_t, uint8_t
+Output    : none
+Remarks   : sets one 4 bit pixel in a line 
+-------------------------------------------*/
+static inline void set_pixel(uint8_t* row, uint32_t x, uint8_t value){
+    if(0 == (x&0x01)){
+      row[x/2] = (row[x/2]&0x0F) | ( (value<<4) &0xF0);
+    } else {
+      row[x/2] = (row[x/2]&0xF0) | (value&0x0F);
+    }
+}
+
+/*-----------------------------------------
+Function  : rle4_decode_row
+Input     : rle4_state_t*, uint8_t*, uint32_t
+Output    : bool
+Remarks   : decodes one line of a BI_RLE4 
+            image into palette indices, pixel
+            not set by the data are index 0
+-------------------------------------------*/
+static bool rle4_decode_row(rle4_state_t* state, uint8_t* row, uint32_t width){
+    memset(row, 0, (width+1)/2);
+    if( (true == state->endofbitmap) || (state->skiplines>0) ){
+      //Line is skipped by a delta or we are already done
+      if(state->skiplines>0){
+        state->skiplines--;
       }
+      return true;
     }
-    
-    
-    //We can send the data to the display now...
-    DBGPRINT.printf("Data loaded into memory (%i ms), read to be send...\n\r",(millis()-start) );
+    uint32_t x = state->startx;
+    state->startx = 0;
+    while(1==1){
+      int16_t count = stream_read(state->stream);
+      int16_t value = stream_read(state->stream);
+      if( (count<0) || (value<0) ){
+        state->error = true;
+        return false;
+      }
+      if(count>0){
+        //Encoded mode, count pixel alternating with the two nibbles of value
+        for(int16_t i=0;i<count;i++){
+          if(x<width){
+            set_pixel(row, x, (0 == (i&0x01)) ? (value>>4) : (value&0x0F) );
+          }
+          x++;
+        }
+      } else if (0 == value){
+        //End of line
+        return true;
+      } else if (1 == value){
+        //End of bitmap, all following lines are empty
+        state->endofbitmap = true;
+        return true;
+      } else if (2 == value){
+        //Delta, next pixel is dx right and dy lines up
+        int16_t dx = stream_read(state->stream);
+        int16_t dy = stream_read(state->stream);
+        if( (dx<0) || (dy<0) ){
+          state->error = true;
+          return false;
+        }
+        x += dx;
+        if(dy>0){
+          state->skiplines = dy-1;
+          state->startx = x;
+          return true;
+        }
+      } else {
+        //Absolute mode, value pixel follow packed in (value+1)/2 bytes padded to 16 bit
+        uint16_t bytes = (value+1)/2;
+        for(uint16_t i=0;i<bytes;i++){
+          int16_t data = stream_read(state->stream);
+          if(data<0){
+            state->error = true;
+            return false;
+          }
+          for(uint8_t n=0;n<2;n++){
+            if( (x<width) && ( ((i*2)+n) < value ) ){
+              set_pixel(row, x, (0 == n) ? (data>>4) : (data&0x0F) );
+            }
+            x++;
+          }
+        }
+        if(bytes&0x01){
+          stream_read(state->stream);
+        }
+      }
+    }
+}
+
+/* Everything needed to read the image data line by line */
+typedef struct{
+  File* file;
+  uint32_t width;
+  uint32_t height;
+  uint16_t bitperpixel;
+  uint32_t stride;
+  uint32_t dataoffset;
+  bool topdown;               //first line in the file is the top line
+  bool topfirst;              //lines are read top first
+  uint32_t nextline;          //next line to read, counted from the first one read
+  uint8_t* line;              //one line as stored in the file, RLE4 already decoded
+  palette_color_t* palette;   //256 entries, used when lines are converted to BGR
+  bmp_stream_t* stream;       //only used for RLE4
+  rle4_state_t rle4;
+  uint32_t bytesread;
+  uint32_t readtime;          //us spent reading from the card
+} bmp_reader_t;
+
+/*-----------------------------------------
+Function  : reader_read_line
+Input     : bmp_reader_t*
+Output    : bool
+Remarks   : reads the next line into line
+-------------------------------------------*/
+static bool reader_read_line(bmp_reader_t* reader){
+    uint32_t line = reader->nextline++;
+    if(line>=reader->height){
+      return false;
+    }
+    if(NULL != reader->stream){
+      return rle4_decode_row(&reader->rle4, reader->line, reader->width);
+    }
+    //Lines are read against the file order with one seek per line, this is slow on FatFs
+    if( (reader->topdown != reader->topfirst) && 
+        (false == reader->file->seek(reader->dataoffset+((reader->height-1-line)*reader->stride))) ){
+      return false;
+    }
+    uint32_t start = micros();
+    uint32_t got = reader->file->read(reader->line, reader->stride);
+    reader->readtime += micros()-start;
+    if(reader->stride != got){
+      return false;
+    }
+    reader->bytesread += reader->stride;
     return true;
 }
 
-bool load_bitmap_for_epd_array(uint8_t* data, uint8_t* buffer){
-   // If we could open a file we will print some debug information
+/*-----------------------------------------
+Function  : reader_skip_lines
+Input     : bmp_reader_t*, uint32_t
+Output    : bool
+Remarks   : skips lines we don't need, these 
+            are not read from the card if the
+            image is not compressed
+-------------------------------------------*/
+static bool reader_skip_lines(bmp_reader_t* reader, uint32_t count){
+    reader->nextline += count;
+    if(reader->topdown != reader->topfirst){
+      //reader_read_line seeks to every line anyway
+      return true;
+    }
+    if(NULL == reader->stream){
+      return reader->file->seek(reader->dataoffset+(reader->nextline*reader->stride));
+    }
+    for(uint32_t i=0;i<count;i++){
+      if(false == rle4_decode_row(&reader->rle4, reader->line, reader->width)){
+        return false;
+      }
+    }
+    return true;
+}
+
+/*-----------------------------------------
+Function  : reader_line_bgr
+Input     : bmp_reader_t*, uint8_t*
+Output    : const uint8_t*
+Remarks   : returns the current line as BGR
+            pixel, 4 and 8 bit lines are 
+            converted into bgr
+-------------------------------------------*/
+static const uint8_t* reader_line_bgr(bmp_reader_t* reader, uint8_t* bgr){
+    if(24 == reader->bitperpixel){
+      return reader->line;
+    }
+    for(uint32_t i=0;i<reader->width;i++){
+      uint8_t index;
+      if(8 == reader->bitperpixel){
+        index = reader->line[i];
+      } else {
+        index = (0 == (i&0x01)) ? (reader->line[i/2]>>4) : (reader->line[i/2]&0x0F);
+      }
+      bgr[(i*3)+0]=reader->palette[index].b;
+      bgr[(i*3)+1]=reader->palette[index].g;
+      bgr[(i*3)+2]=reader->palette[index].r;
+    }
+    return bgr;
+}
+
+/*-----------------------------------------
+Function  : get_pixel
+Input     : const uint8_t*, uint32_t
+Output    : uint8_t
+Remarks   : reads one 4 bit pixel of a line
+-------------------------------------------*/
+static inline uint8_t get_pixel(const uint8_t* row, uint32_t x){
+    return (0 == (x&0x01)) ? (row[x/2]>>4) : (row[x/2]&0x0F);
+}
+
+/*-----------------------------------------
+Function  : rotate_band
+Input     : const uint8_t*, uint8_t*, uint32_t, uint32_t
+Output    : none
+Remarks   : rotates lines first..first+count
+            of the landscape image out of a 
+            448 x 600 4 bit image. Output lines 
+            are in file order, so convert_row
+            can be used as for other images.
+            Work is done in 8x8 pixel tiles, the 
+            band covers full cache lines of the 
+            source (count/2 bytes per line) so 
+            every source line is only fetched
+            once per band from PSRAM
+-------------------------------------------*/
+static void rotate_band(const uint8_t* source, uint8_t* band, uint32_t first, uint32_t count){
+    const uint32_t srcstride = EPD_HEIGHT/2;
+    const uint32_t bytesperline = EPD_WIDTH/2;
+    for(uint32_t tx=0;tx<EPD_WIDTH;tx+=BMP_ROTATE_TILE){
+      for(uint32_t ty=0;ty<count;ty+=BMP_ROTATE_TILE){
+        for(uint32_t x=tx;x<(tx+BMP_ROTATE_TILE);x++){
+          //Line x of the landscape image is one column of the portrait source
+          #if BMP_PORTRAIT_ROTATION == 90
+          const uint8_t* srcline = &source[x*srcstride];
+          #else
+          const uint8_t* srcline = &source[(EPD_WIDTH-1-x)*srcstride];
+          #endif
+          for(uint32_t y=ty;y<(ty+BMP_ROTATE_TILE);y++){
+            #if BMP_PORTRAIT_ROTATION == 90
+            uint8_t value = get_pixel(srcline, EPD_HEIGHT-1-(first+y));
+            #else
+            uint8_t value = get_pixel(srcline, first+y);
+            #endif
+            set_pixel(&band[y*bytesperline], x, value);
+          }
+        }
+      }
+    }
+}
+
+/*-----------------------------------------
+Function  : send_line
+Input     : bmp_sink_t*, const uint8_t*, uint32_t*
+Output    : none
+Remarks   : hands one display line to the sink
+            and adds the time needed to sinktime
+-------------------------------------------*/
+static void send_line(bmp_sink_t* sink, const uint8_t* row, uint32_t* sinktime){
+    uint32_t start = millis();
+    sink->write(sink->ctx, row);
+    *sinktime += millis()-start;
+}
+
+/*-----------------------------------------
+Function  : deadline_passed
+Input     : uint32_t
+Output    : bool
+Remarks   : true once millis() reached the
+            deadline, never for 0
+-------------------------------------------*/
+static inline bool deadline_passed(uint32_t deadline){
+    return (0 != deadline) && ((int32_t)(millis()-deadline) >= 0);
+}
+
+/*-----------------------------------------
+Function  : dither_mode_from_name
+Input     : String
+Output    : dither_mode_t
+Remarks   : the mode can be set per image with
+            a tag at the end of the name, e.g.
+            holiday_b8.bmp, without the default
+            mode is used
+            _fs -> Floyd-Steinberg
+            _b4 -> Bayer 4x4
+            _b8 -> Bayer 8x8
+            _bn -> Blue noise
+-------------------------------------------*/
+static dither_mode_t dither_mode_from_name(String filename){
+    String name = filename;
+    name.toLowerCase();
+    if(true == name.endsWith("_fs.bmp")){
+      return DITHER_FLOYD_STEINBERG;
+    }
+    if(true == name.endsWith("_b4.bmp")){
+      return DITHER_BAYER4;
+    }
+    if(true == name.endsWith("_b8.bmp")){
+      return DITHER_BAYER8;
+    }
+    if(true == name.endsWith("_bn.bmp")){
+      return DITHER_BLUE_NOISE;
+    }
+    return DITHER_DEFAULT_MODE;
+}
+
+bool load_bitmap_to_sink(fs::FS &fs, String path, String filename, bmp_sink_t* sink, uint32_t deadline){
+    // If we could open a file we will print some debug information
     uint32_t start = millis();    
-    if(!data){
-      DBGPRINT.println("Can't open data, NULL ptr");
+    File file = fs.open(path+"/"+filename);
+    if(!file){
+      DBGPRINT.println("Reader can't open file");
       return false;
     }
-    
+    DBGPRINT.print("  FILE returned: ");
+    DBGPRINT.print(file.name());
+    DBGPRINT.print("  SIZE: ");
+    DBGPRINT.println(file.size());
+
     //Next is to load the BMP/DIB header
     BMP_Header_t BMPHeader;
     DIB_Header_t DIBHeader;
     BMP_Color_Pallette16_t Palette;
-    memcpy( (void*)(&BMPHeader), (void*)(data), sizeof(BMPHeader));
-    DBGPRINT.printf("Header id %c %c\n\r",BMPHeader.id[0],BMPHeader.id[1]);
-    DBGPRINT.printf("Filesize = %i\n\r", BMPHeader.FileSize);
-    DBGPRINT.printf("Data offset = %i\n\r", BMPHeader.ImageDataOffset);
-    memcpy((char*)(&DIBHeader), (void*)(data+ sizeof(BMPHeader) ), sizeof(DIBHeader));
-    DBGPRINT.printf("Image width %i\n\r", DIBHeader.imgwidth);
-    DBGPRINT.printf("Image height %i\n\r", DIBHeader.imgheight);
-    DBGPRINT.printf("Bitperpixel %i\n\r", DIBHeader.bitperpixel); //if this is less than 8 we have a color palette 
-    //Next is to read the plattet depeding on the bits per pixel
-    //1 bit per pixel means 2 entries
-    //4 bit per pixel means 16 entry
-    //8 bit per pixel means 256 entry
-    if(DIBHeader.bitperpixel!=4){ //May support later 1bpp images?
-      DBGPRINT.println("We can only process 4 bit per pixel for now");
-    
+    if( (sizeof(BMPHeader) != file.readBytes((char*)(&BMPHeader), sizeof(BMPHeader))) ||
+        (sizeof(DIBHeader) != file.readBytes((char*)(&DIBHeader), sizeof(DIBHeader))) ||
+        ('B' != BMPHeader.id[0]) || ('M' != BMPHeader.id[1]) ){
+      DBGPRINT.println("Not a bitmap");
+      file.close();
+      return false;
+    }
+    if(false == check_bitmap_header(&BMPHeader, &DIBHeader, file.size())){
+      file.close();
       return false;
     }
-    memcpy((void*)(&Palette), (void*)(data+sizeof(BMPHeader)+sizeof(DIBHeader)), sizeof(Palette));
-    for(uint32_t i=0;i<16;i++){
-      DBGPRINT.printf("Color entry %i\n\r", i);
-      DBGPRINT.printf("Color dword 0x%08x -> ",Palette.entry[i].colordword );
-      DBGPRINT.printf("R: [ 0x%02x / %i ] ",Palette.entry[i].color.r, Palette.entry[i].color.r  );      
-      DBGPRINT.printf("G: [ 0x%02x / %i ] ",Palette.entry[i].color.g, Palette.entry[i].color.g );      
-      DBGPRINT.printf("B: [ 0x%02x / %i ]\n\r",Palette.entry[i].color.b, Palette.entry[i].color.b );      
-      
-      color_lut[i].input=Palette.entry[i].color;
-      switch (Palette.entry[i].colordword){
 
-        case rgb_red:{
-          color_lut[i].output=epd_red;        
-        }break;
+    bmp_reader_t reader;
+    reader.file = &file;
+    reader.width = DIBHeader.imgwidth;
+    reader.topdown = (DIBHeader.imgheight<0);
+    reader.topfirst = false;
+    reader.height = (true == reader.topdown) ? -DIBHeader.imgheight : DIBHeader.imgheight;
+    reader.bitperpixel = DIBHeader.bitperpixel;
+    //Every line is padded to 4 bytes
+    reader.stride = ( ( (DIBHeader.imgwidth*DIBHeader.bitperpixel)+31 )/32 )*4;
+    reader.dataoffset = BMPHeader.ImageDataOffset;
+    reader.nextline = 0;
+    reader.bytesread = 0;
+    reader.readtime = 0;
+    reader.stream = NULL;
+    //4 bit images with the display size only need the color LUT, everything 
+    //else is converted to BGR, scaled to the display size and dithered
+    bool native = ( (4 == DIBHeader.bitperpixel) && (EPD_WIDTH == reader.width) && (EPD_HEIGHT == reader.height) );
+    //4 bit portrait images are read completely and rotated
+    bool portrait = ( (4 == DIBHeader.bitperpixel) && (EPD_HEIGHT == reader.width) && (EPD_WIDTH == reader.height) );
+    uint8_t* frame = NULL;
+    uint8_t* band = NULL;
+    uint8_t* bgr = NULL;
+    uint8_t* outbgr = NULL;
+    dither_t dither;
+    dither.error = NULL;
+    scaler_t scaler;
+    scaler.sums = NULL;
+    scaler.columns = NULL;
+    reader.line = (uint8_t*)malloc(reader.stride);
+    reader.palette = (palette_color_t*)calloc(256, sizeof(palette_color_t));
+    bool buffers_ok = (NULL != reader.line) && (NULL != reader.palette);
 
-        case rgb_black:{
-          color_lut[i].output=epd_black;
-        }break;
-        
-        case rgb_green:{
-          color_lut[i].output=epd_green;
-        }break;
+    //Palette follows the DIB header, newer headers are longer than ours
+    file.seek(sizeof(BMPHeader)+DIBHeader.headersize);
+    if( (true == buffers_ok) && (DIBHeader.bitperpixel<=8) ){
+      uint32_t colors = DIBHeader.colorsinpalette;
+      if( (0 == colors) || (colors > (1UL<<DIBHeader.bitperpixel)) ){
+        colors = 1UL<<DIBHeader.bitperpixel;
+      }
+      //Never read into the image data
+      uint32_t palettespace = (BMPHeader.ImageDataOffset-sizeof(BMPHeader)-DIBHeader.headersize)/sizeof(palette_color_t);
+      if(colors>palettespace){
+        colors = palettespace;
+      }
+      file.readBytes((char*)(reader.palette), colors*sizeof(palette_color_t));
+    }
 
-        case rgb_yellow:{
-          color_lut[i].output=epd_yellow;
-        }break;
+    if( (true == native) || (true == portrait) ){
+      memcpy(&Palette, reader.palette, sizeof(Palette));
+      setup_color_lut(&Palette);
+    } 
+    if(true == portrait){
+      //Source goes to PSRAM if we have it, the band must be in internal RAM
+      if(ESP.getPsramSize() > (reader.stride*reader.height)){
+        frame = (uint8_t*)ps_malloc(reader.stride*reader.height);
+      } else {
+        frame = (uint8_t*)malloc(reader.stride*reader.height);
+      }
+      band = (uint8_t*)heap_caps_malloc(BMP_ROTATE_BAND_LINES*(EPD_WIDTH/2), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+      buffers_ok = buffers_ok && (NULL != frame) && (NULL != band);
+    } else if( (false == native) && (true == buffers_ok) ) {
+      dither_mode_t mode = dither_mode_from_name(filename);
+      DBGPRINT.printf("Dither mode %i\n\r", mode);
+      outbgr = (uint8_t*)malloc(EPD_WIDTH*3);
+      buffers_ok = (NULL != outbgr) && dither_begin(&dither, EPD_WIDTH, mode) && 
+                   scaler_begin(&scaler, reader.width, reader.height, SCALER_LETTERBOX);
+      if(24 != DIBHeader.bitperpixel){
+        bgr = (uint8_t*)malloc(reader.width*3);
+        buffers_ok = buffers_ok && (NULL != bgr);
+      }
+      if(true == buffers_ok){
+        DBGPRINT.printf("Scale %ix%i at %i/%i to %ix%i at %i/%i\n\r", scaler.windowwidth, scaler.windowheight, scaler.windowx, scaler.windowy, 
+                                                                      scaler.outwidth, scaler.outheight, scaler.outx, scaler.outy);
+      }
+    }
 
-        case rgb_blue :{
-          color_lut[i].output=epd_blue;
-        }break;
+    //RLE4 images are decoded line by line while the data is read in small chunks
+    if(BMP_COMP_BI_RLE4 == DIBHeader.compression){
+      reader.stream = (bmp_stream_t*)malloc(sizeof(bmp_stream_t));
+      buffers_ok = buffers_ok && (NULL != reader.stream);
+      if(NULL != reader.stream){
+        reader.stream->file = &file;
+        reader.stream->fill = 0;
+        reader.stream->pos = 0;
+        reader.stream->bytesread = 0;
+        reader.stream->readtime = 0;
+        reader.rle4.stream = reader.stream;
+        reader.rle4.skiplines = 0;
+        reader.rle4.startx = 0;
+        reader.rle4.endofbitmap = false;
+        reader.rle4.error = false;
+      }
+    }
 
-        case rgb_transparent:{
-          color_lut[i].output=epd_transparent;
-        }break;
-        
-        case rgb_white:{
-          color_lut[i].output=epd_white;
-        }break;
+    //Portrait images are read into the frame in any order, other top-down
+    //files are only read forward with BMP_TOPDOWN_SCAN and a sink that 
+    //takes them top first
+    reader.topfirst = (true == reader.topdown) && (NULL == reader.stream) && 
+                      ( (true == portrait) || ( (true == BMP_TOPDOWN_SCAN) && (NULL != sink->begin) ) );
+    uint8_t row[EPD_WIDTH/2];
+    uint32_t bytesperline = EPD_WIDTH/2;
+    uint32_t sinktime = 0;
+    uint32_t lines = 0;
+    bool result = buffers_ok;
+    bool late = false;
+    if(false == buffers_ok){
+      DBGPRINT.println("No memory for the decoder");
+    } else {
+      bool sinktopfirst = (true == reader.topfirst) && (false == portrait);
+      if(NULL != sink->begin){
+        sink->begin(sink->ctx, sinktopfirst);
+      }
+      file.seek(BMPHeader.ImageDataOffset); //Jump to raw data and start reading.....
+      //we have only 7 ish colors so we map everything bejond color 7 as transparent (only  0 to 6 are valid colors)
+      //each line is converted and handed to the sink while the next one is read
+      if(true == native){
+        //every byte holds 2 pixel, we read 300 bytes per line and 448 lines of data
+        for(lines=0;lines<EPD_HEIGHT;lines++){
+          if(true == deadline_passed(deadline)){
+            late = true;
+            break;
+          }
+          if(false == reader_read_line(&reader)){
+            //A cut off file is shown with the rest white
+            DBGPRINT.printf("Short read in line %i, rest is white\n\r", lines);
+            break;
+          }
+          convert_row(reader.line, bytesperline);
+          send_line(sink, reader.line, &sinktime);
+        }
+      } else if(true == portrait){
+        uint8_t* line = reader.line;
+        for(uint32_t y=0;y<reader.height;y++){
+          if(true == deadline_passed(deadline)){
+            late = true;
+            break;
+          }
+          //The frame is kept bottom line first
+          reader.line = &frame[( (true == reader.topfirst) ? (reader.height-1-y) : y )*reader.stride];
+          if(false == reader_read_line(&reader)){
+            //Nothing is send yet, the rotation needs the whole file
+            DBGPRINT.printf("Short read in line %i\n\r", y);
+            result = false;
+            break;
+          }
+        }
+        reader.line = line;
+        uint32_t rotatestart = millis();
+        for(lines=0;(lines<EPD_HEIGHT) && (true == result) && (false == late);lines+=BMP_ROTATE_BAND_LINES){
+          if(true == deadline_passed(deadline)){
+            late = true;
+            break;
+          }
+          rotate_band(frame, band, lines, BMP_ROTATE_BAND_LINES);
+          for(uint32_t i=0;i<BMP_ROTATE_BAND_LINES;i++){
+            convert_row(&band[i*bytesperline], bytesperline);
+            send_line(sink, &band[i*bytesperline], &sinktime);
+          }
+        }
+        DBGPRINT.printf("Rotate and send %i ms\n\r", millis()-rotatestart);
+      } else {
+        //Lines above and below the scaled image are white, outy and windowy
+        //are counted from the bottom
+        uint32_t outfirst = scaler.outy;
+        uint32_t windowfirst = scaler.windowy;
+        if(true == sinktopfirst){
+          outfirst = EPD_HEIGHT-scaler.outy-scaler.outheight;
+          windowfirst = reader.height-scaler.windowy-scaler.windowheight;
+        }
+        memset(row, (epd_white<<4) | epd_white, bytesperline);
+        for(lines=0;lines<outfirst;lines++){
+          send_line(sink, row, &sinktime);
+        }
+        if(false == reader_skip_lines(&reader, windowfirst)){
+          DBGPRINT.println("Can't skip lines");
+          result = false;
+        }
+        for(uint32_t y=0;(y<scaler.windowheight) && (true == result);y++){
+          if(true == deadline_passed(deadline)){
+            late = true;
+            break;
+          }
+          if(false == reader_read_line(&reader)){
+            //A cut off file is shown with the rest white
+            DBGPRINT.printf("Short read in line %i, rest is white\n\r", y+windowfirst);
+            break;
+          }
+          if(true == scaler_add_row(&scaler, reader_line_bgr(&reader, bgr), outbgr)){
+            dither_row(&dither, outbgr, row);
+            send_line(sink, row, &sinktime);
+            lines++;
+          }
+        }
+      }
+      if(true == late){
+        //Nothing more is send, the caller has no time left for the image
+        DBGPRINT.printf("Deadline reached after %i lines\n\r", lines);
+        result = false;
+      } else if(true == result) {
+        //We need to finish the transfer, rest of the image will be white
+        memset(row, (epd_white<<4) | epd_white, bytesperline);
+        for(;lines<EPD_HEIGHT;lines++){
+          send_line(sink, row, &sinktime);
+        }
+      }
+    }
+    file.close();   
+    if(NULL != reader.stream){
+      reader.bytesread = reader.stream->bytesread;
+      reader.readtime = reader.stream->readtime;
+      free(reader.stream);
+    }
+    free(reader.line);
+    free(reader.palette);
+    free(bgr);
+    free(outbgr);
+    free(frame);
+    free(band);
+    dither_end(&dither);
+    scaler_end(&scaler);
 
-        default:{
-          color_lut[i].output=epd_transparent;
-        }break;
+    uint32_t duration = millis()-start;
+    DBGPRINT.printf("Image decoded (%i ms), waited %i ms for the output\n\r", duration, sinktime );
+    DBGPRINT.printf("Image data read %i bytes, read and decode %i ms\n\r", reader.bytesread, duration-sinktime );
+    //Bytes per us are MB/s, shows if the card gets slower over time
+    uint32_t speed = (reader.readtime > 0) ? (uint32_t)(((uint64_t)reader.bytesread*100)/reader.readtime) : 0;
+    DBGPRINT.printf("Card read %u ms, %u.%02u MB/s\n\r", reader.readtime/1000, speed/100, speed%100 );
+    return result;
+}
 
-      }
-      
+typedef struct {
+  uint8_t block;
+  uint16_t lines;
+  bool last;
+  bool result;
+} pipeline_msg_t;
 
+typedef struct {
+  fs::FS* fs;
+  String path;
+  String filename;
+  uint8_t* blocks[2];
+  QueueHandle_t freeblocks;
+  QueueHandle_t fullblocks;
+  uint8_t current;
+  uint16_t lines;
+  bool topfirst;         //set by the decoder before the first block
+} pipeline_t;
 
+/*-----------------------------------------
+Function  : pipeline_write
+Input     : void*, const uint8_t*
+Output    : none
+Remarks   : sink of the decoder task, copies the
+            line to the current block and hands a
+            full block to the sender, waits for 
+            the next free one
+-------------------------------------------*/
+static void pipeline_write(void* ctx, const uint8_t* line){
+    pipeline_t* pipe = (pipeline_t*)ctx;
+    memcpy(&pipe->blocks[pipe->current][pipe->lines*(EPD_WIDTH/2)], line, EPD_WIDTH/2);
+    pipe->lines++;
+    if(BMP_PIPELINE_LINES == pipe->lines){
+      pipeline_msg_t msg = { pipe->current, pipe->lines, false, true };
+      xQueueSend(pipe->fullblocks, &msg, portMAX_DELAY);
+      xQueueReceive(pipe->freeblocks, &pipe->current, portMAX_DELAY);
+      pipe->lines = 0;
     }
-   
-    if(DIBHeader.imgwidth!=600){
-      DBGPRINT.println("With not 600\n\r");
+}
 
-      return false;
-    }
+/*-----------------------------------------
+Function  : pipeline_begin
+Input     : void*, bool
+Output    : none
+Remarks   : the sender reads the line order
+            once it has the first block
+-------------------------------------------*/
+static void pipeline_begin(void* ctx, bool topfirst){
+    ((pipeline_t*)ctx)->topfirst = topfirst;
+}
 
-    if(DIBHeader.imgheight!=448){
-      DBGPRINT.println("Height != 448");
+/*-----------------------------------------
+Function  : tskDecode
+Input     : void*
+Output    : none
+Remarks   : decoder task of the pipeline, the last
+            message carries the remaining lines and
+            the result, pipeline_t is not touched
+            after that
+-------------------------------------------*/
+static void tskDecode(void* arg){
+    pipeline_t* pipe = (pipeline_t*)arg;
+    bmp_sink_t sink = { pipeline_write, pipe, pipeline_begin };
+    xQueueReceive(pipe->freeblocks, &pipe->current, portMAX_DELAY);
+    pipe->lines = 0;
+    bool result = load_bitmap_to_sink(*pipe->fs, pipe->path, pipe->filename, &sink);
+    pipeline_msg_t msg = { pipe->current, pipe->lines, true, result };
+    xQueueSend(pipe->fullblocks, &msg, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
 
-      return false;
-    }
+/*-----------------------------------------
+Function  : epd_write
+Input     : void*, const uint8_t*
+Output    : none
+Remarks   : sink sending every line directly
+-------------------------------------------*/
+static void epd_write(void* ctx, const uint8_t* line){
+    ((Epd*)ctx)->EPD_5IN65F_SendImageData(line, EPD_WIDTH/2);
+}
 
-    //we have only 7 ish colors so we map everything bejond color 7 as transparent (only  0 to 6 are valid colors)
-    //every byte holds 2 pixel, we read 300 bytes per line and 448 lines of data
-    memcpy((void*)(buffer),(void*)(data+BMPHeader.ImageDataOffset), ( BMPHeader.FileSize-BMPHeader.ImageDataOffset ) );
-    //At this point we won't need the SD-Card any longer....
-    //We need to change color according to a color palette we have in RAM
-    uint32_t bytesperline = DIBHeader.imgwidth/2;
-    for(uint32_t x=0;x<(DIBHeader.imgheight);x++){  
-      for(uint32_t i=0;i<(bytesperline);i++){
-       
-        uint32_t offset = bytesperline*x;
-        
-        uint8_t pixel_a[2];
-        uint8_t pixel_b[2];
-        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
-        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
-        pixel_a[0]=color_lut[pixel_a[0]].output;
-        pixel_a[1]=color_lut[pixel_a[1]].output;
-        buffer[offset+i]= ( (pixel_a[0]<<4) &0xF0) | (pixel_a[1]&0x0F);
+/*-----------------------------------------
+Function  : epd_begin
+Input     : void*, bool
+Output    : none
+Remarks   : starts the transfer in the order 
+            the lines will come
+-------------------------------------------*/
+static void epd_begin(void* ctx, bool topfirst){
+    ((Epd*)ctx)->EPD_5IN65F_BeginImage(topfirst);
+}
 
-        
+bool load_bitmap_for_epd(fs::FS &fs, String path, String filename, Epd &epd){
+    uint32_t start = millis();
+    pipeline_t pipe;
+    pipe.fs = &fs;
+    pipe.path = path;
+    pipe.filename = filename;
+    pipe.topfirst = false;
+    for(uint8_t i=0;i<2;i++){
+      pipe.blocks[i] = (uint8_t*)heap_caps_malloc(BMP_PIPELINE_LINES*(EPD_WIDTH/2), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    pipe.freeblocks = xQueueCreate(2, sizeof(uint8_t));
+    pipe.fullblocks = xQueueCreate(2, sizeof(pipeline_msg_t));
+    bool pipeline_ok = (NULL != pipe.blocks[0]) && (NULL != pipe.blocks[1]) && 
+                       (NULL != pipe.freeblocks) && (NULL != pipe.fullblocks);
+    if(true == pipeline_ok){
+      for(uint8_t i=0;i<2;i++){
+        xQueueSend(pipe.freeblocks, &i, 0);
       }
+      pipeline_ok = ( pdPASS == xTaskCreatePinnedToCore(tskDecode, "Decode Task", BMP_PIPELINE_STACK, &pipe, BMP_PIPELINE_PRIO, NULL, BMP_PIPELINE_CORE) );
     }
-    //image is color corrected in ram but we need also to mirror it vertically
-    
-    for(uint32_t x=0;x<(DIBHeader.imgheight);x++){  
-      for(uint32_t i=0;i<(bytesperline/2);i++){
-       
-        uint32_t offset = bytesperline*x;
-        
-        uint8_t pixel_a[2];
-        uint8_t pixel_b[2];
-        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
-        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
-        
-        pixel_b[0]=(buffer[offset+bytesperline-1-i]>>4)&0x0F;
-        pixel_b[1]=(buffer[offset+bytesperline-1-i]>>0)&0x0F;
-        
 
-        
-        buffer[offset+bytesperline-1-i]= ( (pixel_a[1]<<4) &0xF0) | (pixel_a[0]&0x0F);
-        buffer[offset+i] = ( (pixel_b[1]<<4) &0xF0) | (pixel_b[0]&0x0F);
-        
+    bool result = false;
+    if(false == pipeline_ok){
+      //Not enough memory for a second task, decode and send one after another
+      DBGPRINT.println("No pipeline, decode and send in one task");
+      bmp_sink_t sink = { epd_write, &epd, epd_begin };
+      result = load_bitmap_to_sink(fs, path, filename, &sink);
+    } else {
+      //Blocks are send while the decoder fills the other one, the display
+      //transfer is only started with the first block so an unusable file
+      //leaves the display untouched
+      bool started = false;
+      uint32_t sendtime = 0;
+      pipeline_msg_t msg;
+      while(1==1){
+        xQueueReceive(pipe.fullblocks, &msg, portMAX_DELAY);
+        if(msg.lines > 0){
+          uint32_t sendstart = millis();
+          if(false == started){
+            epd.EPD_5IN65F_BeginImage(pipe.topfirst);
+            started = true;
+          }
+          epd.EPD_5IN65F_SendImageData(pipe.blocks[msg.block], msg.lines*(EPD_WIDTH/2));
+          sendtime += millis()-sendstart;
+        }
+        if(true == msg.last){
+          result = msg.result;
+          break;
+        }
+        xQueueSend(pipe.freeblocks, &msg.block, portMAX_DELAY);
       }
+      DBGPRINT.printf("Data send to display (%i ms, sending %i ms), ready for refresh...\n\r", millis()-start, sendtime);
     }
-    
-    
-    //We can send the data to the display now...
-    DBGPRINT.printf("Data loaded into memory (%i ms), read to be send...\n\r",(millis()-start) );
-    return true;
-}
-
 
+    free(pipe.blocks[0]);
+    free(pipe.blocks[1]);
+    if(NULL != pipe.freeblocks){
+      vQueueDelete(pipe.freeblocks);
+    }
+    if(NULL != pipe.fullblocks){
+      vQueueDelete(pipe.fullblocks);
+    }
+    return result;
+}
@@ -1,10 +1,48 @@
 #include "FS.h"
+#include "epd5in65f.h"
+
+/* 
+  The reader hands every finished display line (EPD_WIDTH/2 bytes, already
+  in display order) to a sink, this can be the display or anything else.
+  Lines come bottom first, a sink with begin set is told before the first
+  line if they come top first instead (top-down files, read forward)
+*/
+typedef void (*bmp_line_sink_fn)(void* ctx, const uint8_t* line);
+typedef void (*bmp_begin_sink_fn)(void* ctx, bool topfirst);
+
+typedef struct {
+  bmp_line_sink_fn write;
+  void* ctx;
+  bmp_begin_sink_fn begin;   //NULL, lines always come bottom first
+} bmp_sink_t;
+
 /*-----------------------------------------
-Function  : load_bitmap_for_epd
-Input     : fs:FS, String, String, uint8_t*
+Function  : load_bitmap_to_sink
+Input     : fs:FS, String, String, bmp_sink_t*,
+            uint32_t
 Output    : bool
-Remarks   : none
+Remarks   : reads the bitmap line by line and
+            passes exactly EPD_HEIGHT lines to
+            the sink, nothing is passed if the
+            file is not a usable bitmap. A file
+            that ends early is shown with the
+            rest white and counts as read, only
+            portrait images fail as they are 
+            rotated from the whole file. Once
+            millis() reaches deadline (0 for 
+            none) it stops at the next line and
+            returns false, the sink then has 
+            fewer lines
 -------------------------------------------*/
-bool load_bitmap_for_epd(fs::FS &fs, String path, String filename, uint8_t* buffer);
+bool load_bitmap_to_sink(fs::FS &fs, String path, String filename, bmp_sink_t* sink, uint32_t deadline = 0);
 
-bool load_bitmap_for_epd_array(uint8_t* data, uint8_t* buffer);
\ No newline at end of file
+/*-----------------------------------------
+Function  : load_bitmap_for_epd
+Input     : fs:FS, String, String, Epd&
+Output    : bool
+Remarks   : reads the bitmap line by line and
+            streams it to the display, the caller
+            needs to wake the display before and
+            refresh it afterwards
+-------------------------------------------*/
+bool load_bitmap_for_epd(fs::FS &fs, String path, String filename, Epd &epd);
@@ -0,0 +1,311 @@
+#include "dither.h"
+
+/* Colors the display can show, index is the display color */
+typedef struct{
+  int16_t r;
+  int16_t g;
+  int16_t b;
+} dither_color_t;
+
+/* Colors used as target for the dithering, same as the conversion palette */
+static const dither_color_t dither_palette[7]={
+  {0x00, 0x00, 0x00}, //EPD_5IN65F_BLACK
+  {0xFF, 0xFF, 0xFF}, //EPD_5IN65F_WHITE
+  {0x22, 0xB1, 0x4C}, //EPD_5IN65F_GREEN
+  {0x3F, 0x48, 0xCC}, //EPD_5IN65F_BLUE
+  {0xED, 0x1C, 0x24}, //EPD_5IN65F_RED
+  {0xFF, 0xF2, 0x00}, //EPD_5IN65F_YELLOW
+  {0xFF, 0x7F, 0x27}  //EPD_5IN65F_ORANGE
+};
+
+/* 
+  Ordered dithering moves every pixel by up to +-ORDERED_SPREAD/2 
+  before the nearest color is taken, the threshold matrices hold 0..255 
+*/
+#define ORDERED_SPREAD 256
+
+/* Bayer matrix value, bits=2 gives 4x4, bits=3 gives 8x8 (recursive construction) */
+constexpr uint8_t bayer_value(uint8_t x, uint8_t y, uint8_t bits){
+  return (0 == bits) ? 0 : 
+         (uint8_t)( ( ( ( ((x^y)&1)<<1 ) | (y&1) ) << (2*(bits-1)) ) + bayer_value(x>>1, y>>1, bits-1) );
+}
+
+#define BAYER4(x,y) (uint8_t)(bayer_value(x,y,2)*16+8)
+#define BAYER4_ROW(y) BAYER4(0,y), BAYER4(1,y), BAYER4(2,y), BAYER4(3,y)
+#define BAYER8(x,y) (uint8_t)(bayer_value(x,y,3)*4+2)
+#define BAYER8_ROW(y) BAYER8(0,y), BAYER8(1,y), BAYER8(2,y), BAYER8(3,y), \
+                      BAYER8(4,y), BAYER8(5,y), BAYER8(6,y), BAYER8(7,y)
+
+static constexpr uint8_t bayer4[4*4]={
+  BAYER4_ROW(0), BAYER4_ROW(1), BAYER4_ROW(2), BAYER4_ROW(3)
+};
+
+static constexpr uint8_t bayer8[8*8]={
+  BAYER8_ROW(0), BAYER8_ROW(1), BAYER8_ROW(2), BAYER8_ROW(3),
+  BAYER8_ROW(4), BAYER8_ROW(5), BAYER8_ROW(6), BAYER8_ROW(7)
+};
+
+/* 32x32 blue noise tile, void-and-cluster (sigma 1.5), ranks scaled to 0..255 */
+#define BLUE_NOISE_SIZE 32
+static const uint8_t blue_noise[BLUE_NOISE_SIZE*BLUE_NOISE_SIZE]={
+  249,  10, 117,  71, 160, 195,  80, 107,  46, 132,  29, 209,  74, 162,  18, 180,  48, 207,  75, 241,  99, 168,   9, 178, 117,  47, 141, 183,  19, 237,  38,  96,
+   77, 179, 144,  30,  93,   4, 227,  23, 185, 233,  88, 147, 112,  45, 223,  71, 255, 140,  21, 151,  39, 204, 251,  36, 214,  97, 241,  75, 149, 210, 127, 156,
+   35, 220,  52, 209, 253, 135, 174, 122,  67, 152,   2, 188, 247, 134, 200, 100,  29, 114, 174, 219,  65, 127,  86, 155,  68, 167,  26, 199,  51, 107,   1, 192,
+  104, 133,  86, 186, 111,  61,  37, 245, 204, 102, 221,  62,  34,  87,   7, 156, 193, 227,  51,  94, 185,  13, 229, 135,   4, 223, 123,  88, 161, 225,  70, 245,
+  167, 236,   6, 157,  20, 221, 163,  85,  14,  47, 166, 118, 207, 176, 237,  59, 124,  82,  18, 137, 239, 107,  53, 196, 101, 181,  41, 252,  13, 178, 139,  24,
+   44,  66, 119, 229,  79, 198, 103, 145, 187, 130, 234,  24,  73, 141, 104,  40, 170, 243, 200, 160,  33, 210, 171,  27, 244,  63, 142, 205, 110,  49,  95, 213,
+  147, 202, 178,  36, 140,  53,  25, 238,  69, 211,  83, 151, 252,  11, 190, 220, 143,   2,  58,  89, 122,  67, 147,  81, 119, 161,  17,  79, 130, 233, 191,  77,
+  252,  17,  88, 242, 111, 174, 218, 120,  42,   4, 108, 173,  54, 123,  91,  29,  75, 116, 215, 186, 253,  10, 231, 198,  44, 210, 230, 184,  33, 154,   5, 121,
+  170, 105,  57, 157, 208,   7,  85, 158, 179, 242, 195,  35, 206, 228, 155, 196, 249, 173,  25, 141,  41, 166,  94, 131,   1, 108,  58,  98, 247,  68, 216,  39,
+  138, 222, 194,  29,  70, 134, 254,  56, 100, 142,  64, 132,  84,  16,  61, 129,  46,  99, 234,  78, 111, 220,  54, 155, 250, 177, 138,  23, 168, 112, 187,  84,
+   54,   0, 124, 237,  99, 181,  20, 203,  31, 229,  12, 164, 245, 114, 171, 212,   7, 161,  57, 206, 176,  22, 193,  71,  34,  83, 225, 199,  47, 143,  15, 239,
+  160, 184,  76, 150,  46, 224, 113, 146,  76, 123, 212,  95, 189,  42, 237,  82, 109, 193, 137,  12, 128,  91, 236, 121, 213, 159,  13, 122,  78, 230, 205,  98,
+   34, 246, 107, 215,  10, 162,  63, 241, 188, 169,  52,  27, 146,  73,  19, 150, 224,  33, 246,  72, 227,  42, 144,   7, 184, 111,  61, 243, 180,  25,  59, 132,
+  221,  65,  21, 191, 129,  89, 209,  40,   2,  90, 251, 117, 221, 201, 131, 186,  60,  93, 171, 114, 158, 190,  64, 248,  93,  45, 207, 139,  90, 157, 110, 177,
+   87, 143, 169,  49, 250,  27, 176, 109, 133, 198,  66, 153,   6, 101,  47, 255, 120,   0, 213,  50,  14, 219, 106,  30, 152, 232, 171,   3,  41, 201, 234,   8,
+  197, 115, 211,  97,  69, 144, 236,  55, 160, 230,  36, 181, 235,  80, 172,  24, 157, 197, 136, 238,  85, 131, 169, 203,  76,  20, 128, 103, 255,  72, 124,  54,
+  248,  38,  11, 230, 113, 202,   8,  79, 215,  15, 106, 128,  53, 208, 115, 228,  86,  64,  37, 103, 187,  23,  55, 226, 118, 193,  67, 218, 183, 148,  30, 159,
+   68, 135, 183, 154,  32, 170, 126, 188,  95, 148,  70, 244, 164,  11, 138,  35, 182, 242, 148, 207,  71, 253, 147,  96,  39, 242, 163,  51,  16,  96, 212, 174,
+  105, 235,  84,  57, 217,  91,  43, 254,  27, 175, 219,  19,  92, 190,  72, 216, 108,   8, 172,  26, 118, 164,  12, 189, 136,   6,  90, 142, 118, 240,  81,   3,
+   45, 204, 125,  14, 243, 143,  66, 208, 133,  56, 117, 200, 151,  43, 236, 155,  52, 129,  92, 223,  49, 233,  82, 214,  62, 172, 204, 232,  42, 194, 130, 225,
+  145,  20, 168, 194, 104, 179,   1, 163, 102, 232,  34,  81, 250, 124,  97,  19, 196, 251,  63, 182, 137, 105,  38, 126, 249, 110,  28,  75, 156,  18,  60, 185,
+   78, 248,  96,  69,  31, 119, 226,  77,  21, 191, 145, 180,  62,  28, 211, 177,  78, 144,  32, 206,   2, 168, 196,  17, 153,  50, 223, 187, 101, 252, 165, 113,
+  222,  37, 152, 209, 238,  51, 199, 152, 247,  53,  94,   4, 132, 226, 162, 110,   6, 231, 116,  86, 246,  73, 231,  98, 182,  82, 135,   0, 125,  48, 203,  25,
+  175,  59, 133,   5, 165, 129,  88,  40, 115, 214, 166, 234, 194,  84,  39,  59, 202, 170,  49, 158, 125,  43, 141,  60, 216,  21, 244, 164, 212,  70, 142,  98,
+  121, 214, 190, 106,  72, 222,  11, 181, 134,  14,  73, 112,  22, 153, 122, 248, 137,  95, 216,  17, 178, 224,  10, 163, 120, 197, 103,  44,  90, 229,   9, 241,
+   46,  15,  85, 255,  35, 192, 150, 243,  64, 195, 156, 254,  48, 217, 180,  15,  74,  28, 240,  63,  99, 201,  83, 253,  32,  56, 149, 179,  26, 189, 154,  80,
+  167, 227, 148, 173,  55, 123,  94,  23, 105, 224,  31,  93, 140,  67, 102, 228, 188, 150, 113, 192, 134,  37, 149, 109, 175, 228,  74, 240, 112, 130,  36, 200,
+  127,  61, 114,  22, 201, 231,  76, 210, 172,  55, 126, 183, 205,   0, 166,  44,  87, 211,  43, 165,   5, 238,  68, 206,  12,  97, 139,   8, 217,  62, 249, 100,
+  208,  32, 244,  89, 139,   1, 159,  41, 138, 239,  16,  80, 232, 116, 247, 145, 125,  13, 251,  79, 218, 121, 185,  50, 128, 215,  40, 199, 158,  87, 177,   3,
+   77, 186, 153, 217,  66, 182, 250, 115,  69, 203, 165,  38, 149,  56,  24, 197,  65, 175, 106,  52, 154,  89,  18, 162, 245,  81, 173, 108,  26,  48, 146, 235,
+  136, 102,  45,  16, 127, 100,  31, 192,   9,  91, 120, 222, 101, 189,  83, 219,  33, 233, 136, 202,  30, 235, 213, 104,  28, 151,  60, 254, 191, 220, 116,  22,
+   57, 225, 169, 205, 239,  50, 146, 218, 161, 246,  58, 176,   9, 240, 131, 109, 159,  92,   3, 184, 119,  58, 140,  74, 195, 226,   5, 126,  92,  65, 167, 198
+};
+
+typedef struct{
+  float l;
+  float a;
+  float b;
+} lab_color_t;
+
+/* 
+  Nearest display color for r,g,b with 4 bit per channel, index is the
+  closest level (0..15, level k is k*17) of r, g and b, build once so the
+  dithering has no per pixel distance calculation 
+*/
+#define NEAREST_LUT_BITS 4
+static uint8_t nearest_lut[1<<(3*NEAREST_LUT_BITS)];
+static bool nearest_lut_valid = false;
+
+static inline int16_t clamp_color(int16_t value){
+  if(value<0){
+    return 0;
+  }
+  if(value>255){
+    return 255;
+  }
+  return value;
+}
+
+static float srgb_to_linear(float value){
+  value = value/255.0f;
+  if(value<=0.04045f){
+    return value/12.92f;
+  }
+  return powf( (value+0.055f)/1.055f, 2.4f);
+}
+
+static float lab_f(float t){
+  if(t>0.008856f){
+    return cbrtf(t);
+  }
+  return (7.787f*t)+(16.0f/116.0f);
+}
+
+/*-----------------------------------------
+Function  : rgb_to_lab
+Input     : float, float, float
+Output    : lab_color_t
+Remarks   : sRGB (D65) to CIELAB
+-------------------------------------------*/
+static lab_color_t rgb_to_lab(float r, float g, float b){
+  r = srgb_to_linear(r);
+  g = srgb_to_linear(g);
+  b = srgb_to_linear(b);
+  float x = ( (0.4124f*r) + (0.3576f*g) + (0.1805f*b) )/0.95047f;
+  float y = ( (0.2126f*r) + (0.7152f*g) + (0.0722f*b) );
+  float z = ( (0.0193f*r) + (0.1192f*g) + (0.9505f*b) )/1.08883f;
+  lab_color_t lab;
+  lab.l = (116.0f*lab_f(y))-16.0f;
+  lab.a = 500.0f*(lab_f(x)-lab_f(y));
+  lab.b = 200.0f*(lab_f(y)-lab_f(z));
+  return lab;
+}
+
+/*-----------------------------------------
+Function  : nearest_lab
+Input     : lab_color_t, const lab_color_t*
+Output    : uint8_t
+Remarks   : display color with the smallest
+            CIELAB distance in palette
+-------------------------------------------*/
+static uint8_t nearest_lab(lab_color_t color, const lab_color_t* palette){
+  uint8_t best = 0;
+  float bestdistance = 1e30f;
+  for(uint8_t i=0;i<7;i++){
+    float dl = color.l - palette[i].l;
+    float da = color.a - palette[i].a;
+    float db = color.b - palette[i].b;
+    float distance = (dl*dl) + (da*da) + (db*db);
+    if(distance<bestdistance){
+      bestdistance = distance;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/*-----------------------------------------
+Function  : setup_nearest_lut
+Input     : none
+Output    : none
+Remarks   : fills nearest_lut, the dithering
+            works against the conversion palette
+            so the error stays consistent
+-------------------------------------------*/
+static void setup_nearest_lut( void ){
+  const uint32_t levels = 1<<NEAREST_LUT_BITS;
+  const float step = 255.0f/(levels-1);
+  lab_color_t palette[7];
+  for(uint8_t i=0;i<7;i++){
+    palette[i] = rgb_to_lab(dither_palette[i].r, dither_palette[i].g, dither_palette[i].b);
+  }
+  for(uint32_t r=0;r<levels;r++){
+    for(uint32_t g=0;g<levels;g++){
+      for(uint32_t b=0;b<levels;b++){
+        lab_color_t lab = rgb_to_lab(r*step, g*step, b*step);
+        nearest_lut[(r<<(2*NEAREST_LUT_BITS)) | (g<<NEAREST_LUT_BITS) | b] = nearest_lab(lab, palette);
+      }
+    }
+  }
+  nearest_lut_valid = true;
+}
+
+/* Closest table level for a channel value, the levels are k*255/(levels-1) */
+#define NEAREST_LUT_LEVEL(v) ( ( ((v)*((1<<NEAREST_LUT_BITS)-1)) + 127 ) / 255 )
+
+static inline uint8_t nearest_color(int16_t r, int16_t g, int16_t b){
+  return nearest_lut[ ( NEAREST_LUT_LEVEL(r)<<(2*NEAREST_LUT_BITS) ) |
+                      ( NEAREST_LUT_LEVEL(g)<<NEAREST_LUT_BITS ) |
+                        NEAREST_LUT_LEVEL(b) ];
+}
+
+uint8_t dither_nearest_color(uint8_t r, uint8_t g, uint8_t b){
+  //Same palette as the dithering, the bitmap colors are in the same range
+  lab_color_t palette[7];
+  for(uint8_t i=0;i<7;i++){
+    palette[i] = rgb_to_lab(dither_palette[i].r, dither_palette[i].g, dither_palette[i].b);
+  }
+  return nearest_lab(rgb_to_lab(r, g, b), palette);
+}
+
+bool dither_begin(dither_t* dither, uint32_t width, dither_mode_t mode){
+  dither->mode = mode;
+  dither->width = width;
+  dither->y = 0;
+  dither->current = 0;
+  dither->error = NULL;
+  if(false == nearest_lut_valid){
+    setup_nearest_lut();
+  }
+  if(DITHER_FLOYD_STEINBERG != mode){
+    //Ordered modes need no buffer at all
+    return true;
+  }
+  dither->error = (int16_t*)calloc( 2*(width+2)*3, sizeof(int16_t) );
+  return (NULL != dither->error);
+}
+
+static inline void put_pixel(uint8_t* out, uint32_t width, uint32_t x, uint8_t color){
+  //Display line is mirrored
+  uint32_t pos = width-1-x;
+  if(0 == (pos&0x01)){
+    out[pos/2] = (out[pos/2]&0x0F) | (color<<4);
+  } else {
+    out[pos/2] = (out[pos/2]&0xF0) | color;
+  }
+}
+
+/*-----------------------------------------
+Function  : dither_row_ordered
+Input     : dither_t*, const uint8_t*, uint8_t*
+Output    : none
+Remarks   : threshold matrix dithering, every
+            pixel only depends on its position
+-------------------------------------------*/
+static void dither_row_ordered(dither_t* dither, const uint8_t* bgr, uint8_t* out){
+  const uint8_t* matrix;
+  uint32_t size;
+  switch(dither->mode){
+    case DITHER_BAYER4:{
+      matrix = bayer4;
+      size = 4;
+    }break;
+
+    case DITHER_BAYER8:{
+      matrix = bayer8;
+      size = 8;
+    }break;
+
+    default:{
+      matrix = blue_noise;
+      size = BLUE_NOISE_SIZE;
+    }break;
+  }
+  const uint8_t* thresholds = &matrix[(dither->y%size)*size];
+  for(uint32_t x=0;x<dither->width;x++){
+    int16_t offset = ( ( (int16_t)thresholds[x%size] - 128 ) * ORDERED_SPREAD ) / 256;
+    int16_t r = clamp_color(bgr[(x*3)+2] + offset);
+    int16_t g = clamp_color(bgr[(x*3)+1] + offset);
+    int16_t b = clamp_color(bgr[(x*3)+0] + offset);
+    put_pixel(out, dither->width, x, nearest_color(r, g, b));
+  }
+}
+
+void dither_row(dither_t* dither, const uint8_t* bgr, uint8_t* out){
+  if(DITHER_FLOYD_STEINBERG != dither->mode){
+    dither_row_ordered(dither, bgr, out);
+    dither->y++;
+    return;
+  }
+  uint32_t linesize = (dither->width+2)*3;
+  int16_t* cur = &dither->error[dither->current*linesize];
+  int16_t* next = &dither->error[(dither->current^1)*linesize];
+  memset(next, 0, linesize*sizeof(int16_t));
+  //Error for pixel x is stored at x+1, so neighbours never need a bounds check
+  for(uint32_t x=0;x<dither->width;x++){
+    int16_t* e = &cur[(x+1)*3];
+    int16_t r = clamp_color(bgr[(x*3)+2] + ((e[0]+8)>>4) );
+    int16_t g = clamp_color(bgr[(x*3)+1] + ((e[1]+8)>>4) );
+    int16_t b = clamp_color(bgr[(x*3)+0] + ((e[2]+8)>>4) );
+    uint8_t color = nearest_color(r, g, b);
+    int16_t error[3];
+    error[0] = r - dither_palette[color].r;
+    error[1] = g - dither_palette[color].g;
+    error[2] = b - dither_palette[color].b;
+    for(uint8_t c=0;c<3;c++){
+      cur[((x+2)*3)+c]  += error[c]*7;
+      next[((x+0)*3)+c] += error[c]*3;
+      next[((x+1)*3)+c] += error[c]*5;
+      next[((x+2)*3)+c] += error[c]*1;
+    }
+    put_pixel(out, dither->width, x, color);
+  }
+  dither->current ^= 1;
+  dither->y++;
+}
+
+void dither_end(dither_t* dither){
+  free(dither->error);
+  dither->error = NULL;
+}
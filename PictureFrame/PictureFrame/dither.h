@@ -0,0 +1,62 @@
+#include <Arduino.h>
+#include "epd5in65f.h"
+
+/* Dithering modes, error diffusion looks best, ordered ones need no error buffer */
+typedef enum{
+  DITHER_FLOYD_STEINBERG = 0,
+  DITHER_BAYER4,
+  DITHER_BAYER8,
+  DITHER_BLUE_NOISE
+} dither_mode_t;
+
+/* Used for all images without a mode in the filename */
+#define DITHER_DEFAULT_MODE DITHER_FLOYD_STEINBERG
+
+/* State of the dithering, for error diffusion only two lines of error are kept */
+typedef struct{
+  dither_mode_t mode;
+  uint32_t width;
+  uint32_t y;           //line count, selects the threshold row for ordered modes
+  int16_t* error;       //two lines of (width+2)*3 entries, in 1/16 steps
+  uint8_t current;      //line in error that belongs to the current row
+} dither_t;
+
+/*-----------------------------------------
+Function  : dither_nearest_color
+Input     : uint8_t, uint8_t, uint8_t
+Output    : uint8_t
+Remarks   : display color perceptually closest
+            (CIELAB) to r,g,b among the 
+            conversion palette colors, used to
+            map palettes
+-------------------------------------------*/
+uint8_t dither_nearest_color(uint8_t r, uint8_t g, uint8_t b);
+
+/*-----------------------------------------
+Function  : dither_begin
+Input     : dither_t*, uint32_t, dither_mode_t
+Output    : bool
+Remarks   : allocates the error lines for
+            images with width pixel, builds the
+            color lookup table on first use
+-------------------------------------------*/
+bool dither_begin(dither_t* dither, uint32_t width, dither_mode_t mode);
+
+/*-----------------------------------------
+Function  : dither_row
+Input     : dither_t*, const uint8_t*, uint8_t*
+Output    : none
+Remarks   : quantizes one line of BGR pixel
+            (bitmap order) to display colors, 
+            output is packed and mirrored as the 
+            display needs it
+-------------------------------------------*/
+void dither_row(dither_t* dither, const uint8_t* bgr, uint8_t* out);
+
+/*-----------------------------------------
+Function  : dither_end
+Input     : dither_t*
+Output    : none
+Remarks   : frees the error lines
+-------------------------------------------*/
+void dither_end(dither_t* dither);
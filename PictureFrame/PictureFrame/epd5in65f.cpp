@@ -32,13 +32,50 @@
 #include <stdlib.h>
 #include <Arduino.h>
 #include "epd5in65f.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
 
 //#define NOEPD
 #define DBGPRINT Serial1
+
+/* 
+  Controller init sequence as used by Wake(), every entry is the command,
+  the number of data bytes and the data. The pseudo commands below are
+  handled by SendSequence() and never send to the controller
+*/
+#define EPD_SEQ_END        0xFF    /// end of the sequence
+#define EPD_SEQ_WAIT_BUSY  0xFE    /// wait until BUSY is high
+#define EPD_SEQ_DELAY      0xFD    /// wait, one data byte in ms
+
+static constexpr UBYTE epd_init_sequence[] = {
+    EPD_SEQ_WAIT_BUSY, 0,                       //Ready after the reset
+    0x00, 2, 0xEF, 0x08,                        //Panel setting
+    0x01, 4, 0x37, 0x00, 0x23, 0x23,            //Power setting
+    0x03, 1, 0x00,                              //Power off sequence
+    0x06, 3, 0xC7, 0xC7, 0x1D,                  //Booster soft start
+    0x30, 1, 0x3C,                              //PLL, 50 Hz
+    0x41, 1, 0x00,                              //Temperature sensor
+    0x50, 1, 0x37,                              //VCOM and data interval
+    0x60, 1, 0x22,                              //TCON
+    0x61, 4, 0x02, 0x58, 0x01, 0xC0,            //Resolution 600 x 448
+    0xE3, 1, 0xAA,                              //Power saving
+    EPD_SEQ_DELAY, 1, 100,                      //No BUSY for this one, keep the demo delay
+    0x50, 1, 0x37,                              //VCOM and data interval
+    EPD_SEQ_END
+};
+
+/* 
+  After the reset the controller pulls BUSY low while it starts up, the
+  init sequence then waits for BUSY high. If BUSY is not seen low within 
+  EPD_RESET_BUSY_MS the demo delay is used instead, so a late or missed
+  BUSY never lets the init run into a controller that is not ready
+*/
+#define EPD_RESET_BUSY_MS 50
+#define EPD_RESET_DELAY_MS 200
 Epd::~Epd() {
 };
 
-Epd::Epd(SPIClass * SPI_BUS, int16_t DIN_Pin, int16_t CS_Pin, int16_t SCK_Pin, int16_t RESET_Pin, int16_t DC_Pin, int16_t BUSY_Pin) {
+Epd::Epd(SPIClass * SPI_BUS, int16_t DIN_Pin, int16_t CS_Pin, int16_t SCK_Pin, int16_t RESET_Pin, int16_t DC_Pin, int16_t BUSY_Pin, uint32_t SPI_Hz) {
     _DIN_Pin=DIN_Pin;
     _CS_Pin=CS_Pin;
     _SCK_Pin=SCK_Pin;
@@ -46,9 +83,16 @@ Epd::Epd(SPIClass * SPI_BUS, int16_t DIN_Pin, int16_t CS_Pin, int16_t SCK_Pin, i
     _DC_Pin=DC_Pin;
     _BUSY_Pin=BUSY_Pin;
     _SPI_BUS=SPI_BUS;
+    _SPI_Hz=SPI_Hz;
+    spi_started=false;
+    scan_topfirst=false;
     
     width = EPD_WIDTH;
     height = EPD_HEIGHT;
+    transfer_start = 0;
+    transfer_bytes = 0;
+    refresh_ms = 0;
+    frame_hash = 0;
 };
 
 /******************************************************************************
@@ -66,8 +110,88 @@ void Epd::InitSPI(void) {
     /* First setup the SPI Port here */
     this->_SPI_BUS->begin(this->_SCK_Pin, -1 , this->_DIN_Pin, -1); //SCLK, ... , MOSI , we use only clock and dout on the esp32-s3
     //We only use Dout on the ESP32 here 
-    this->_SPI_BUS->beginTransaction(SPISettings(2000000, MSBFIRST, SPI_MODE0));
+    this->_SPI_BUS->beginTransaction(SPISettings(this->_SPI_Hz, MSBFIRST, SPI_MODE0));
+    spi_started = true;
+}
+
+/******************************************************************************
+function :  Changes the SPI clock, takes effect at once if the bus is running
+parameter:  hz : SPI clock in Hz
+******************************************************************************/
+void Epd::SetSPIFrequency(uint32_t hz) {
+    this->_SPI_Hz = hz;
+    if(true == spi_started){
+      this->_SPI_BUS->endTransaction();
+      this->_SPI_BUS->beginTransaction(SPISettings(this->_SPI_Hz, MSBFIRST, SPI_MODE0));
+    }
+}
 
+uint32_t Epd::GetSPIFrequency(void) {
+    return this->_SPI_Hz;
+}
+
+/******************************************************************************
+function :  Finds the fastest SPI clock the panel works with. MISO is not 
+            connected, so nothing can be read back. Instead a test frame 
+            is uploaded at the speeds of EPD_SPI_CALIBRATION_HZ, fastest
+            first, then the panel is powered on and off. A speed counts as 
+            stable if the panel answers both on BUSY within the deadline,
+            the first stable one is taken. This only finds a clock at 
+            which the commands arrive, corrupted pixel data is NOT 
+            detected, that is why the speeds are capped at EPD_SPI_MAX_HZ.
+            Nothing is refreshed, the next image overwrites the test frame.
+            The panel needs to be awake
+return   :  fastest stable clock in Hz (also set), 0 if none worked and
+            the old clock is kept
+******************************************************************************/
+uint32_t Epd::CalibrateSPI(void) {
+    const uint32_t speeds[] = EPD_SPI_CALIBRATION_HZ;
+    uint32_t oldhz = this->_SPI_Hz;
+    for(uint32_t i=0; i<(sizeof(speeds)/sizeof(speeds[0])); i++) {
+        if(speeds[i] > EPD_SPI_MAX_HZ){
+            continue;
+        }
+        SetSPIFrequency(speeds[i]);
+        //Black / white stripes, every byte toggles the data line
+        for(unsigned long x=0; x<width/2; x++) {
+            linebuffer[x] = (x & 1) ? 0x10 : 0x01;
+        }
+        EPD_5IN65F_BeginImage();
+        for(unsigned long y=0; y<height; y++) {
+            EPD_5IN65F_SendImageData(linebuffer, width/2);
+        }
+        LogTransfer();
+        SendCommand(0x04);//0x04 -> Power On
+        bool stable = (EPD_OK == EPD_5IN65F_BusyHigh());
+        SendCommand(0x02);//0x02 -> Power Off
+        stable = (EPD_OK == EPD_5IN65F_BusyLow()) && stable;
+        DBGPRINT.printf("SPI %u kHz %s\n\r", speeds[i]/1000, (true == stable) ? "stable" : "failed");
+        if(true == stable){
+            return speeds[i];
+        }
+    }
+    SetSPIFrequency(oldhz);
+    return 0;
+}
+
+/******************************************************************************
+function :  Next speed of EPD_SPI_CALIBRATION_HZ below hz, used after a 
+            failed refresh instead of a new calibration that would find 
+            the same clock again
+return   :  clock in Hz, EPD_SPI_DEFAULT_HZ if there is no slower one
+******************************************************************************/
+uint32_t Epd::SlowerSPIFrequency(uint32_t hz) {
+    const uint32_t speeds[] = EPD_SPI_CALIBRATION_HZ;
+    uint32_t slower = 0;
+    for(uint32_t i=0; i<(sizeof(speeds)/sizeof(speeds[0])); i++) {
+        if( (speeds[i] < hz) && (speeds[i] > slower) ){
+            slower = speeds[i];
+        }
+    }
+    if(0 == slower){
+        slower = (EPD_SPI_DEFAULT_HZ < hz) ? EPD_SPI_DEFAULT_HZ : hz;
+    }
+    return slower;
 }
 
 
@@ -81,6 +205,55 @@ void Epd::SendCommand(unsigned char command) {
     digitalWrite(this->_CS_Pin, HIGH);
 }
 
+/**
+ *  @brief: sends a block of data with one CS assertion,
+ *          the SPI peripheral pushes the whole block out
+ */
+void Epd::SendDataBlock(const unsigned char* data, uint32_t len) {
+    digitalWrite(this->_DC_Pin, HIGH);
+    digitalWrite(this->_CS_Pin, LOW);
+    this->_SPI_BUS->writeBytes(data, len);
+    digitalWrite(this->_CS_Pin, HIGH);
+}
+
+/**
+ *  @brief: sends a command with its data bytes,
+ *          CS stays low for the whole command
+ */
+void Epd::SendCommandData(unsigned char command, const unsigned char* data, uint32_t len) {
+    digitalWrite(this->_DC_Pin, LOW);
+    digitalWrite(this->_CS_Pin, LOW);
+    this->_SPI_BUS->transfer(command);
+    if(len > 0) {
+        digitalWrite(this->_DC_Pin, HIGH);
+        this->_SPI_BUS->writeBytes(data, len);
+    }
+    digitalWrite(this->_CS_Pin, HIGH);
+}
+
+/******************************************************************************
+function :  Sends a command sequence, see epd_init_sequence for the format
+parameter:  sequence : command table, ends with EPD_SEQ_END
+return   :  EPD_OK or EPD_ERR_BUSY
+******************************************************************************/
+int Epd::SendSequence(const UBYTE* sequence) {
+    while(EPD_SEQ_END != sequence[0]) {
+        UBYTE command = sequence[0];
+        UBYTE len = sequence[1];
+        if(EPD_SEQ_WAIT_BUSY == command) {
+            if(EPD_OK != EPD_5IN65F_BusyHigh()) {
+                return EPD_ERR_BUSY;
+            }
+        } else if(EPD_SEQ_DELAY == command) {
+            delay(sequence[2]);
+        } else {
+            SendCommandData(command, &sequence[2], len);
+        }
+        sequence += 2+len;
+    }
+    return EPD_OK;
+}
+
 /**
  *  @brief: basic function for sending data
  */
@@ -92,167 +265,335 @@ void Epd::SendData(unsigned char data) {
     
 }
 
-void Epd::EPD_5IN65F_BusyHigh(void)// If BUSYN=0 then waiting
-{
+/******************************************************************************
+function :  Waits until BUSY has the given level, the CPU stays in light sleep
+            and is woken by the BUSY level or by the deadline
+parameter:  level      : HIGH or LOW
+            timeout_ms : deadline in ms
+return   :  EPD_OK or EPD_ERR_BUSY
+******************************************************************************/
+int Epd::WaitBusy(int level, uint32_t timeout_ms) {
     #ifdef NOEPD
-      DBGPRINT.print("EPD_5IN65F_BusyHigh() dummy mode (500ms)");
+      DBGPRINT.printf("WaitBusy(%i) dummy mode (500ms)\n\r", level);
       delay(500); //Will simulate a busy line .... sort of
-      return;
+      return EPD_OK;
     #endif
     uint32_t start_time = millis();
-    while(!(digitalRead(this->_BUSY_Pin))){
-        if( (millis()-start_time) > (20*1000) ){
-          //This can be considered as error......
-          DBGPRINT.print("EPD_5IN65F_BusyHigh() > 20s runtime");
-          delay(1);
-          start_time = millis();
-        }                
+    gpio_num_t busy = (gpio_num_t)this->_BUSY_Pin;
+    while(level != digitalRead(this->_BUSY_Pin)){
+      uint32_t elapsed = millis()-start_time;
+      if(elapsed >= timeout_ms){
+        DBGPRINT.printf("BUSY not %s after %u ms, giving up\n\r", (HIGH == level) ? "high" : "low", elapsed);
+        return EPD_ERR_BUSY;
+      }
+      //The level wakeup also fires if BUSY changed before we are asleep
+      gpio_wakeup_enable(busy, (HIGH == level) ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+      esp_sleep_enable_gpio_wakeup();
+      esp_sleep_enable_timer_wakeup((uint64_t)(timeout_ms-elapsed)*1000);
+      DBGPRINT.flush();
+      esp_light_sleep_start();
+      gpio_wakeup_disable(busy);
+      esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+      esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
     }
+    return EPD_OK;
 }
 
-void Epd::EPD_5IN65F_BusyLow(void)// If BUSYN=1 then waiting
+int Epd::EPD_5IN65F_BusyHigh(uint32_t timeout_ms)// If BUSYN=0 then waiting
 {
-    #ifdef NOEPD
-      Serial.print("EPD_5IN65F_BusyLow() dummy mode (500ms)");
-      delay(500); //Will simulate a busy line .... sort of
-      return;
-    #endif
-    //We have here a chance to never return
-    uint32_t start_time = millis();
-    while(digitalRead(this->_BUSY_Pin)){
-      if( (millis()-start_time) > (20*1000) ){
-          //This can be considered as error......
-          DBGPRINT.print("EPD_5IN65F_BusyLow() > 20s runtime");
-          delay(1);
-          start_time = millis();
-        }   
-    }
+    return WaitBusy(HIGH, timeout_ms);
+}
+
+int Epd::EPD_5IN65F_BusyLow(uint32_t timeout_ms)// If BUSYN=1 then waiting
+{
+    return WaitBusy(LOW, timeout_ms);
 }
 
 /**
  *  @brief: module reset.
  *          often used to awaken the module in deep sleep,
- *          see Epd::Sleep();
+ *          see Epd::Sleep(); Returns once the controller
+ *          pulled BUSY low, the caller waits for it to rise.
+ *          Without BUSY low the demo delay is kept
  */
 void Epd::Reset(void) {
     digitalWrite(this->_RESET_Pin, LOW);                //module reset    
     delay(1);
     digitalWrite(this->_RESET_Pin, HIGH);
-    delay(200);    
+    uint32_t start = millis();
+    if(EPD_OK != WaitBusy(LOW, EPD_RESET_BUSY_MS)) {
+        DBGPRINT.printf("No BUSY after reset, waiting %u ms\n\r", EPD_RESET_DELAY_MS);
+        delay(EPD_RESET_DELAY_MS-(millis()-start));
+    }
 }
 
 /******************************************************************************
 function :  Sends the image buffer in RAM to e-Paper and displays
 parameter:
 ******************************************************************************/
-void Epd::EPD_5IN65F_Display(uint8_t *image) {
-    unsigned long i,j;
-    SendCommand(0x61);//Set Resolution setting
-    SendData(0x02);
-    SendData(0x58);
-    SendData(0x01);
-    SendData(0xC0);
-    SendCommand(0x10);
+int Epd::EPD_5IN65F_Display(uint8_t *image) {
+    unsigned long i;
+    EPD_5IN65F_BeginImage();
     for(i=0; i<height; i++) {
-        for(j=0; j<width/2; j++) {
-          SendData(image[j+((width/2)*i)]);
-		    }        
+        EPD_5IN65F_SendImageData(&image[(width/2)*i], width/2);
     }
+    return EPD_5IN65F_Refresh();
+}
+
+/******************************************************************************
+function :  Starts a new image transfer, the caller needs to send
+            height lines of width/2 bytes with EPD_5IN65F_SendImageData()
+            and finish with EPD_5IN65F_Refresh()
+parameter:  topfirst : the lines come top line first instead of bottom
+                       line first, the gate scan is turned (EPD_PSR_UD)
+******************************************************************************/
+void Epd::EPD_5IN65F_BeginImage(bool topfirst) {
+    SetScan(topfirst);
+    const UBYTE resolution[] = { 0x02, 0x58, 0x01, 0xC0 };
+    SendCommandData(0x61, resolution, sizeof(resolution));//Set Resolution setting
+    SendCommand(0x10);
+    transfer_start = micros();
+    transfer_bytes = 0;
+    frame_hash = EPD_FRAME_HASH_INIT;
+    if(true == topfirst) {
+        frame_hash = (frame_hash ^ EPD_FRAME_HASH_TOPFIRST) * EPD_FRAME_HASH_PRIME;
+    }
+}
+
+/******************************************************************************
+function :  Panel setting as in the init sequence with the gate scan direction,
+            only send if the direction changes
+parameter:  topfirst : UD cleared, the first line send is the top line
+******************************************************************************/
+void Epd::SetScan(bool topfirst) {
+    if(topfirst == scan_topfirst) {
+        return;
+    }
+    const UBYTE panel[] = { (UBYTE)((true == topfirst) ? (0xEF & ~EPD_PSR_UD) : 0xEF), 0x08 };
+    SendCommandData(0x00, panel, sizeof(panel));//Panel setting
+    scan_topfirst = topfirst;
+}
+
+/******************************************************************************
+function :  Sends a chunk of image data (panel format, 2 pixel per byte)
+parameter:  data : image data
+            len  : number of bytes
+******************************************************************************/
+void Epd::EPD_5IN65F_SendImageData(const UBYTE *data, uint32_t len) {
+    SendDataBlock(data, len);
+    transfer_bytes += len;
+    uint32_t hash = frame_hash;
+    for(uint32_t i=0; i<len; i++) {
+        hash = (hash ^ data[i]) * EPD_FRAME_HASH_PRIME;
+    }
+    frame_hash = hash;
+}
+
+/******************************************************************************
+function :  Hash of the image send since EPD_5IN65F_BeginImage(), the same
+            frame gives the same hash, 0 if the content is unknown
+parameter:
+******************************************************************************/
+uint32_t Epd::EPD_5IN65F_FrameHash(void) {
+    return frame_hash;
+}
+
+/******************************************************************************
+function :  Prints how long the image transfer since EPD_5IN65F_BeginImage() took
+parameter:
+******************************************************************************/
+void Epd::LogTransfer(void) {
+    uint32_t duration = micros()-transfer_start;
+    DBGPRINT.printf("Image transfer %u bytes in %u ms at %u kHz\n\r", transfer_bytes, duration/1000, this->_SPI_Hz/1000);
+}
+
+/******************************************************************************
+function :  Duration of the last refresh in ms, 0 if there was none
+parameter:
+******************************************************************************/
+uint32_t Epd::EPD_5IN65F_RefreshTime(void) {
+    return refresh_ms;
+}
+
+/******************************************************************************
+function :  Powers the panel, refreshes it with the transfered image
+            and powers it off again
+parameter:
+return   :  EPD_OK or EPD_ERR_BUSY
+******************************************************************************/
+int Epd::EPD_5IN65F_Refresh(void) {
+    LogTransfer();
     SendCommand(0x04);//0x04 -> Power On
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x12);//0x12 -> Refesh display 
-    DBGPRINT.println("Enter lightsleep (25s)");
-    DBGPRINT.flush();
-    esp_sleep_enable_timer_wakeup(25*1000 * 1000); //25s cpu sleep
-    esp_light_sleep_start();            
-    DBGPRINT.println("Exit lightsleep");
-    EPD_5IN65F_BusyHigh();
+    int result = EPD_5IN65F_BusyHigh();
+    if(EPD_OK == result){
+      //The refresh time depends on the temperature, we sleep until BUSY
+      //rises, the timer is only the deadline
+      uint32_t refresh_start = millis();
+      SendCommand(0x12);//0x12 -> Refesh display 
+      result = EPD_5IN65F_BusyHigh(EPD_REFRESH_TIMEOUT_MS);
+      refresh_ms = millis()-refresh_start;
+      DBGPRINT.printf("Refresh %s after %u ms\n\r", (EPD_OK == result) ? "done" : "failed", refresh_ms);
+    }
+    //Power off is also send after an error, the panel shall not stay powered
     SendCommand(0x02);  //0x02  -> Power Off
-    EPD_5IN65F_BusyLow();
+    int poweroff = EPD_5IN65F_BusyLow();
 	  delay(200);
+    return (EPD_OK == result) ? poweroff : result;
 }
 
-void Epd::EPD_5IN65F_SendImage(const UBYTE *image) {
-    
-    SendCommand(0x61);//Set Resolution setting
-    SendData(0x02);
-    SendData(0x58);
-    SendData(0x01);
-    SendData(0xC0);
-    SendCommand(0x10);
-    for(uint32_t i=0; i<134400; i++) {
-            SendData(image[i]);
-    }
+int Epd::EPD_5IN65F_SendImage(const UBYTE *image) {
+    EPD_5IN65F_BeginImage();
+    EPD_5IN65F_SendImageData(image, (width/2)*height);
+    LogTransfer();
     SendCommand(0x04);//0x04
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x12);//0x12
+    int result = EPD_5IN65F_BusyHigh();
+    if(EPD_OK == result){
+      SendCommand(0x12);//0x12
+    }
+    return result;
 }
 
-void Epd::EPD_5IN65F_WaitImageUpdateDone(){
-    EPD_5IN65F_BusyHigh();
+int Epd::EPD_5IN65F_WaitImageUpdateDone(){
+    int result = EPD_5IN65F_BusyHigh(EPD_REFRESH_TIMEOUT_MS);
     SendCommand(0x02);  //0x02  -> Power Off
-    EPD_5IN65F_BusyLow();
+    int poweroff = EPD_5IN65F_BusyLow();
 	  delay(200);
+    return (EPD_OK == result) ? poweroff : result;
 }
 
 
 
 /******************************************************************************
-function :  Sends the part image buffer in RAM to e-Paper and displays
-parameter:
+function :  Sends the part image buffer in RAM to e-Paper and displays, only
+            the window is transfered (partial window mode of the controller)
+parameter:  image        : window content, 2 pixel per byte, 
+                           (image_width+1)/2 bytes per row
+            xstart       : left edge, rounded down to an even pixel
+            ystart       : top line
+            image_width  : width in pixel
+            image_heigh  : height in lines
+return   :  EPD_OK or EPD_ERR_BUSY
+remarks  :  The controller takes horizontal window borders only in steps of 
+            8 pixel. The window is widened to the next steps, the extra 
+            pixels are white, so overlays should be placed on 8 pixel
+            boundaries. Every row is copied once from the image into
+            linebuffer at the offset of xstart inside the window and send
+            as one block, parts outside the panel are clipped. The pad
+            pixel of an odd width is send as white.
+            UNVERIFIED: partial refresh of this ACeP panel is listed in 
+            the datasheet but was only tested on the host model. The 
+            sketch does not use it until it is tested on the hardware
 ******************************************************************************/
-void Epd::EPD_5IN65F_Display_part(const UBYTE *image, UWORD xstart, UWORD ystart, 
+int Epd::EPD_5IN65F_Display_part(const UBYTE *image, UWORD xstart, UWORD ystart, 
                                         UWORD image_width, UWORD image_heigh)
 {
-    unsigned long i,j;
-    SendCommand(0x61);//Set Resolution setting
-    SendData(0x02);
-    SendData(0x58);
-    SendData(0x01);
-    SendData(0xC0);
+    xstart &= ~1;
+    if( (xstart >= width) || (ystart >= height) || (0 == image_width) || (0 == image_heigh) ) {
+        return EPD_OK;
+    }
+    unsigned long xend = xstart+image_width;
+    unsigned long yend = ystart+image_heigh;
+    if(xend > width) {
+        xend = width;
+    }
+    if(yend > height) {
+        yend = height;
+    }
+    unsigned long winx = xstart & ~7UL;
+    unsigned long winxend = (xend+7) & ~7UL;
+    unsigned long rowbytes = (winxend-winx)/2;
+    unsigned long first = (xstart-winx)/2;
+    unsigned long stride = (image_width+1)/2;
+    unsigned long copybytes = (xend-xstart+1)/2;
+
+    //The window is given bottom line first
+    SetScan(false);
+    SendCommand(0x91);//0x91 -> Partial In
+    const UBYTE window[] = {
+        (UBYTE)((winx>>8) & 0x03), (UBYTE)(winx & 0xF8),
+        (UBYTE)(((winxend-1)>>8) & 0x03), (UBYTE)(((winxend-1) & 0xF8) | 0x07),
+        (UBYTE)((ystart>>8) & 0x03), (UBYTE)(ystart & 0xFF),
+        (UBYTE)(((yend-1)>>8) & 0x03), (UBYTE)((yend-1) & 0xFF),
+        0x01 //Scan inside and outside of the window
+    };
+    SendCommandData(0x90, window, sizeof(window));//0x90 -> Partial Window
     SendCommand(0x10);
-    for(i=0; i<height; i++) {
-        for(j=0; j< width/2; j++) {
-            if(i<image_heigh+ystart && i>=ystart && j<(image_width+xstart)/2 && j>=xstart/2) {
-              SendData(pgm_read_byte(&image[(j-xstart/2) + (image_width/2*(i-ystart))]));
-            }
-			else {
-				SendData(0x11);
-			}
-		}
+    transfer_start = micros();
+    transfer_bytes = 0;
+    for(unsigned long i=ystart; i<yend; i++) {
+        memset(linebuffer, 0x11, rowbytes);
+        memcpy(&linebuffer[first], &image[stride*(i-ystart)], copybytes);
+        if(0 != ((xend-xstart) & 1)) {
+            linebuffer[first+copybytes-1] = (linebuffer[first+copybytes-1] & 0xF0) | 0x01;
+        }
+        EPD_5IN65F_SendImageData(linebuffer, rowbytes);
     }
-    SendCommand(0x04);//0x04
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x12);//0x12
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x02);  //0x02
-    EPD_5IN65F_BusyLow();
-	  delay(200);
+    uint32_t sent = transfer_bytes;
+    //Only a part is send, the hash can't describe the whole display
+    frame_hash = 0;
+    int result = EPD_5IN65F_Refresh();
+    SendCommand(0x92);//0x92 -> Partial Out
+    DBGPRINT.printf("Partial window %lux%lu at %lu/%u, %u of %lu bytes send (%lu saved)\n\r", winxend-winx, yend-ystart, winx, ystart, 
+                                                                                         sent, (width/2)*height, (width/2)*height-sent);
+    return result;
 }
 
 /******************************************************************************
 function : 
       Clear screen
 ******************************************************************************/
-void Epd::Clear(UBYTE color) {
-    SendCommand(0x61);//Set Resolution setting
-    SendData(0x02);
-    SendData(0x58);
-    SendData(0x01);
-    SendData(0xC0);
-    SendCommand(0x10);
-    for(int i=0; i<width/2; i++) {
-        for(int j=0; j<height; j++) {
-            SendData((color<<4)|color);
-		}
-	}
-    SendCommand(0x04);//0x04
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x12);//0x12
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x02);  //0x02
-    EPD_5IN65F_BusyLow();
-    delay(500);
+int Epd::Clear(UBYTE color) {
+    return Fill(EPD_FILL_SOLID, color);
+}
+
+/******************************************************************************
+function :  Builds one display line of a fill pattern in linebuffer
+parameter:  pattern : see epd_fill_t
+            color   : first color
+            color2  : second color for stripes and checkerboard
+            line    : display line
+******************************************************************************/
+void Epd::FillLine(epd_fill_t pattern, UBYTE color, UBYTE color2, unsigned long line) {
+    bool oddrow = (0 != ((line/EPD_FILL_CELL) & 1));
+    UBYTE value = (color<<4) | color;
+    UBYTE value2 = (color2<<4) | color2;
+    switch(pattern) {
+        case EPD_FILL_STRIPES:
+            memset(linebuffer, (true == oddrow) ? value2 : value, width/2);
+            break;
+        case EPD_FILL_CHECKER:
+            for(unsigned long x=0; x<width/2; x++) {
+                bool oddcolumn = (0 != (((x*2)/EPD_FILL_CELL) & 1));
+                linebuffer[x] = (oddcolumn != oddrow) ? value2 : value;
+            }
+            break;
+        case EPD_FILL_CLEAN:
+            memset(linebuffer, (EPD_5IN65F_CLEAN<<4) | EPD_5IN65F_CLEAN, width/2);
+            break;
+        default:
+            memset(linebuffer, value, width/2);
+            break;
+    }
+}
+
+/******************************************************************************
+function :  Fills the whole display with a pattern and refreshes it, no frame
+            buffer is needed: one line is build in linebuffer and send again
+            until the pattern changes, that is every EPD_FILL_CELL lines
+parameter:  pattern : see epd_fill_t
+            color   : first color
+            color2  : second color for stripes and checkerboard
+return   :  EPD_OK or EPD_ERR_BUSY
+******************************************************************************/
+int Epd::Fill(epd_fill_t pattern, UBYTE color, UBYTE color2) {
+    EPD_5IN65F_BeginImage();
+    for(unsigned long i=0; i<height; i++) {
+        if(0 == (i % EPD_FILL_CELL)) {
+            FillLine(pattern, color & 0x07, color2 & 0x07, i);
+        }
+        EPD_5IN65F_SendImageData(linebuffer, width/2);
+    }
+    return EPD_5IN65F_Refresh();
 }
 
 /**
@@ -271,47 +612,20 @@ void Epd::Sleep(void) {
 }
 
 
-void Epd::Wake(void){
+/**
+ *  @brief: resets the panel and loads the settings
+ *          from epd_init_sequence, returns EPD_ERR_BUSY
+ *          if the panel does not become ready
+ */
+int Epd::Wake(void){
     pinMode(_CS_Pin,OUTPUT);
     digitalWrite(_CS_Pin, HIGH);
     pinMode(_DC_Pin, OUTPUT);
     pinMode(_RESET_Pin, OUTPUT);
     pinMode(_BUSY_Pin,INPUT_PULLDOWN);
     Reset();
-    EPD_5IN65F_BusyHigh();
-    SendCommand(0x00);
-    SendData(0xEF);
-    SendData(0x08);
-    SendCommand(0x01);
-    SendData(0x37);
-    SendData(0x00);
-    SendData(0x23);
-    SendData(0x23);
-    SendCommand(0x03);
-    SendData(0x00);
-    SendCommand(0x06);
-    SendData(0xC7);
-    SendData(0xC7);
-    SendData(0x1D);
-    SendCommand(0x30);
-    SendData(0x3C);
-    SendCommand(0x41);
-    SendData(0x00);
-    SendCommand(0x50);
-    SendData(0x37);
-    SendCommand(0x60);
-    SendData(0x22);
-    SendCommand(0x61);
-    SendData(0x02);
-    SendData(0x58);
-    SendData(0x01);
-    SendData(0xC0);
-    SendCommand(0xE3);
-    SendData(0xAA);
-	
-    delay(100); //delay function, here okay as we run on an OS
-    
-    SendCommand(0x50);
-    SendData(0x37);
+    //The init sequence sets UD
+    scan_topfirst = false;
+    return SendSequence(epd_init_sequence);
 }
 /* END OF FILE */
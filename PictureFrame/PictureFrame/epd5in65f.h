@@ -53,25 +53,91 @@ Color Index
 #define EPD_5IN65F_ORANGE  0x6	///	110
 #define EPD_5IN65F_CLEAN   0x7	///	111   unavailable  Afterimage
 
+/**********************************
+Fill patterns, stripes and the
+checkerboard use cells of 
+EPD_FILL_CELL pixel
+**********************************/
+typedef enum {
+  EPD_FILL_SOLID = 0,   /// color only
+  EPD_FILL_STRIPES,     /// horizontal stripes of color and color2
+  EPD_FILL_CHECKER,     /// checkerboard of color and color2
+  EPD_FILL_CLEAN        /// clean color, removes afterimages
+} epd_fill_t;
+
+#define EPD_FILL_CELL      8
+
+/**********************************
+Return codes
+**********************************/
+#define EPD_OK             0
+#define EPD_ERR_BUSY      -1    /// BUSY did not change before the deadline
+
+/* 
+  SPI clock for the panel, the controller is specified for writes up to 
+  20 MHz, the default is what the Waveshare demo uses. Calibration tries
+  the speeds of the list fastest first and takes the first the panel 
+  still answers to. Only BUSY can be seen, a clock that corrupts pixels
+  is not detected, so no speed above EPD_SPI_MAX_HZ (half the specified 
+  clock, margin for the flat cable) is ever used
+*/
+#define EPD_SPI_DEFAULT_HZ       2000000
+#define EPD_SPI_MAX_HZ          10000000
+#define EPD_SPI_CALIBRATION_HZ   { 10000000, 8000000, 4000000, 2000000 }
+
+/* FNV-1a over the image data send since EPD_5IN65F_BeginImage(), 0 is unknown */
+#define EPD_FRAME_HASH_INIT   2166136261UL
+#define EPD_FRAME_HASH_PRIME  16777619UL
+/* Hashed before the data of a top first frame, the same bytes are another picture */
+#define EPD_FRAME_HASH_TOPFIRST 0x08
+
+/* 
+  UD bit of the panel setting (0x00), set the gates scan up and the first
+  line send is the bottom line. Cleared the top line comes first, so 
+  top-down files can be streamed forward. Taken from the datasheet and 
+  only tested on the host model so far, the reader only uses it with 
+  BMP_TOPDOWN_SCAN
+*/
+#define EPD_PSR_UD 0x08
+
+/* Deadlines for the BUSY line, a refresh takes longer when it is cold */
+#define EPD_BUSY_TIMEOUT_MS      5000
+#define EPD_REFRESH_TIMEOUT_MS  45000
+
 class Epd {
 public:
-    Epd(SPIClass* SPI_BUS, int16_t DIN_Pin, int16_t CS_Pin, int16_t SCK_Pin, int16_t RESET_Pin, int16_t DC_Pin, int16_t BUSY_Pin);
+    Epd(SPIClass* SPI_BUS, int16_t DIN_Pin, int16_t CS_Pin, int16_t SCK_Pin, int16_t RESET_Pin, int16_t DC_Pin, int16_t BUSY_Pin,
+        uint32_t SPI_Hz = EPD_SPI_DEFAULT_HZ);
     ~Epd();
     int  Init(void);
     void  InitSPI(void);
-	  void EPD_5IN65F_BusyHigh(void);
-	  void EPD_5IN65F_BusyLow(void);
+    void  SetSPIFrequency(uint32_t hz);
+    uint32_t GetSPIFrequency(void);
+    uint32_t CalibrateSPI(void);
+    static uint32_t SlowerSPIFrequency(uint32_t hz);
+	  int EPD_5IN65F_BusyHigh(uint32_t timeout_ms = EPD_BUSY_TIMEOUT_MS);
+	  int EPD_5IN65F_BusyLow(uint32_t timeout_ms = EPD_BUSY_TIMEOUT_MS);
     void Reset(void);
-    void EPD_5IN65F_Display(uint8_t* image);
-    void EPD_5IN65F_Display_part(const UBYTE *image, UWORD xstart, UWORD ystart, 
+    int EPD_5IN65F_Display(uint8_t* image);
+    void EPD_5IN65F_BeginImage(bool topfirst = false);
+    void EPD_5IN65F_SendImageData(const UBYTE *data, uint32_t len);
+    int EPD_5IN65F_Refresh(void);
+    uint32_t EPD_5IN65F_RefreshTime(void);
+    uint32_t EPD_5IN65F_FrameHash(void);
+    //Unverified on the panel, not used by the sketch until tested on hardware
+    int EPD_5IN65F_Display_part(const UBYTE *image, UWORD xstart, UWORD ystart, 
                                  UWORD image_width, UWORD image_heigh);
-    void EPD_5IN65F_SendImage(const UBYTE *image);
-    void EPD_5IN65F_WaitImageUpdateDone( void );
+    int EPD_5IN65F_SendImage(const UBYTE *image);
+    int EPD_5IN65F_WaitImageUpdateDone( void );
     void SendCommand(unsigned char command);
     void SendData(unsigned char data);
-    void Wake(void);
+    void SendDataBlock(const unsigned char* data, uint32_t len);
+    void SendCommandData(unsigned char command, const unsigned char* data, uint32_t len);
+    int SendSequence(const UBYTE* sequence);
+    int Wake(void);
     void Sleep(void);
-    void Clear(UBYTE color);
+    int Clear(UBYTE color);
+    int Fill(epd_fill_t pattern, UBYTE color, UBYTE color2 = EPD_5IN65F_WHITE);
 
 private:
     int16_t _DIN_Pin;
@@ -81,9 +147,20 @@ private:
     int16_t _DC_Pin;
     int16_t _BUSY_Pin;
     SPIClass * _SPI_BUS;
+    uint32_t _SPI_Hz;
+    bool spi_started;
     unsigned long width;
     unsigned long height;
     uint8_t linebuffer[300];
+    uint32_t transfer_start;
+    uint32_t transfer_bytes;
+    uint32_t refresh_ms;
+    uint32_t frame_hash;
+    bool scan_topfirst;    //UD of the panel setting is cleared
+    void LogTransfer(void);
+    void FillLine(epd_fill_t pattern, UBYTE color, UBYTE color2, unsigned long line);
+    int WaitBusy(int level, uint32_t timeout_ms);
+    void SetScan(bool topfirst);
 };
 
 #endif /* EPD5IN83B_HD_H */
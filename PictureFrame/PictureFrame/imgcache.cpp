@@ -0,0 +1,147 @@
+#include "imgcache.h"
+#include "bmpreader.h"
+#include "esp_rom_crc.h"
+
+#define DBGPRINT Serial1
+
+/* State of a slot while the bitmap is decoded into it */
+typedef struct {
+  const esp_partition_t* part;
+  uint32_t offset;       //next line in the partition
+  uint32_t crc;
+  uint32_t hash;
+  bool topfirst;
+  bool failed;
+} cache_writer_t;
+
+/*-----------------------------------------
+Function  : cache_write
+Input     : void*, const uint8_t*
+Output    : none
+Remarks   : sink writing every line to flash
+-------------------------------------------*/
+static void cache_write(void* ctx, const uint8_t* line){
+    cache_writer_t* writer = (cache_writer_t*)ctx;
+    if(true == writer->failed){
+      return;
+    }
+    if(ESP_OK != esp_partition_write(writer->part, writer->offset, line, EPD_WIDTH/2)){
+      writer->failed = true;
+      return;
+    }
+    writer->offset += EPD_WIDTH/2;
+    writer->crc = esp_rom_crc32_le(writer->crc, line, EPD_WIDTH/2);
+    for(uint32_t i=0;i<EPD_WIDTH/2;i++){
+      writer->hash = (writer->hash ^ line[i]) * EPD_FRAME_HASH_PRIME;
+    }
+}
+
+/*-----------------------------------------
+Function  : cache_begin
+Input     : void*, bool
+Output    : none
+Remarks   : the frame is stored in the order 
+            the lines come, the hash follows 
+            Epd::EPD_5IN65F_BeginImage()
+-------------------------------------------*/
+static void cache_begin(void* ctx, bool topfirst){
+    cache_writer_t* writer = (cache_writer_t*)ctx;
+    writer->topfirst = topfirst;
+    if(true == topfirst){
+      writer->hash = (writer->hash ^ EPD_FRAME_HASH_TOPFIRST) * EPD_FRAME_HASH_PRIME;
+    }
+}
+
+const esp_partition_t* imgcache_partition(void){
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, IMAGE_CACHE_LABEL);
+}
+
+uint32_t imgcache_slots(const esp_partition_t* part){
+    if(NULL == part){
+      return 0;
+    }
+    return part->size / IMAGE_CACHE_SLOT_SIZE;
+}
+
+bool imgcache_header(const esp_partition_t* part, uint32_t slot, image_cache_header_t* header){
+    if(slot >= imgcache_slots(part)){
+      return false;
+    }
+    if(ESP_OK != esp_partition_read(part, slot*IMAGE_CACHE_SLOT_SIZE, header, sizeof(image_cache_header_t))){
+      return false;
+    }
+    return (IMAGE_CACHE_MAGIC == header->magic);
+}
+
+bool imgcache_store(const esp_partition_t* part, uint32_t slot, fs::FS &fs, String path, String filename, uint32_t file_hash, uint32_t deadline){
+    uint32_t start = millis();
+    if(slot >= imgcache_slots(part)){
+      return false;
+    }
+    uint32_t base = slot*IMAGE_CACHE_SLOT_SIZE;
+    if(ESP_OK != esp_partition_erase_range(part, base, IMAGE_CACHE_SLOT_SIZE)){
+      DBGPRINT.printf("Erase of cache slot %u failed\n\r", slot);
+      return false;
+    }
+    cache_writer_t writer;
+    writer.part = part;
+    writer.offset = base + sizeof(image_cache_header_t);
+    writer.crc = 0;
+    writer.hash = EPD_FRAME_HASH_INIT;
+    writer.topfirst = false;
+    writer.failed = false;
+    bmp_sink_t sink = { cache_write, &writer, cache_begin };
+    if( (false == load_bitmap_to_sink(fs, path, filename, &sink, deadline)) || (true == writer.failed) ||
+        (writer.offset != (base + sizeof(image_cache_header_t) + IMAGE_CACHE_FRAME_SIZE)) ){
+      DBGPRINT.printf("%s not stored in cache slot %u\n\r", filename.c_str(), slot);
+      return false;
+    }
+    image_cache_header_t header;
+    header.magic = IMAGE_CACHE_MAGIC;
+    header.file_hash = file_hash;
+    header.frame_hash = writer.hash;
+    header.crc = writer.crc;
+    header.flags = (true == writer.topfirst) ? IMAGE_CACHE_TOPFIRST : 0;
+    if(ESP_OK != esp_partition_write(part, base, &header, sizeof(header))){
+      return false;
+    }
+    DBGPRINT.printf("%s stored in cache slot %u in %u ms\n\r", filename.c_str(), slot, millis()-start);
+    return true;
+}
+
+bool imgcache_send(const esp_partition_t* part, uint32_t slot, Epd &epd){
+    uint32_t start = millis();
+    image_cache_header_t header;
+    if(false == imgcache_header(part, slot, &header)){
+      DBGPRINT.printf("Cache slot %u is empty\n\r", slot);
+      return false;
+    }
+    uint32_t chunk = IMAGE_CACHE_READ_LINES*(EPD_WIDTH/2);
+    uint8_t* buffer = (uint8_t*)malloc(chunk);
+    if(NULL == buffer){
+      return false;
+    }
+    //The CRC is checked while sending, a bad frame is simply not refreshed
+    uint32_t offset = slot*IMAGE_CACHE_SLOT_SIZE + sizeof(image_cache_header_t);
+    uint32_t crc = 0;
+    bool result = true;
+    epd.EPD_5IN65F_BeginImage(0 != (header.flags & IMAGE_CACHE_TOPFIRST));
+    for(uint32_t sent=0;sent<IMAGE_CACHE_FRAME_SIZE;sent+=chunk){
+      uint32_t len = min(chunk, (uint32_t)(IMAGE_CACHE_FRAME_SIZE-sent));
+      if(ESP_OK != esp_partition_read(part, offset+sent, buffer, len)){
+        result = false;
+        break;
+      }
+      crc = esp_rom_crc32_le(crc, buffer, len);
+      epd.EPD_5IN65F_SendImageData(buffer, len);
+    }
+    free(buffer);
+    if( (true == result) && (crc != header.crc) ){
+      DBGPRINT.printf("Cache slot %u is corrupt\n\r", slot);
+      result = false;
+    }
+    if(true == result){
+      DBGPRINT.printf("Cache slot %u send in %u ms\n\r", slot, millis()-start);
+    }
+    return result;
+}
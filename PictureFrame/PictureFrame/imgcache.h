@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include "FS.h"
+#include "esp_partition.h"
+#include "epd5in65f.h"
+
+/*
+  Cache of images in display format in a data partition of the internal
+  flash (label "imgcache", see partitions.csv). The partition is a row of
+  fixed size slots, every slot holds one frame behind a small header. The
+  header is written last, so a slot that was not filled completely is
+  never valid
+*/
+#define IMAGE_CACHE_LABEL      "imgcache"
+#define IMAGE_CACHE_MAGIC      0x32484341UL   /// "ACH2", header with flags
+/* Frame is stored top line first, see Epd::EPD_5IN65F_BeginImage() */
+#define IMAGE_CACHE_TOPFIRST   0x00000001UL
+#define IMAGE_CACHE_FRAME_SIZE ((EPD_WIDTH/2)*EPD_HEIGHT)
+/* Header and frame rounded up to the 4k flash sector */
+#define IMAGE_CACHE_SLOT_SIZE  0x21000UL
+/* Lines read from flash at once when the frame is send */
+#define IMAGE_CACHE_READ_LINES 16
+
+typedef struct __attribute__((__packed__)){
+  uint32_t magic;
+  uint32_t file_hash;    //identity of the file the frame was made from
+  uint32_t frame_hash;   //same hash as Epd::EPD_5IN65F_FrameHash(), a slot with the frame on the display is not send
+  uint32_t crc;          //CRC32 of the frame
+  uint32_t flags;        //IMAGE_CACHE_TOPFIRST
+} image_cache_header_t;
+
+/*-----------------------------------------
+Function  : imgcache_partition
+Input     : none
+Output    : const esp_partition_t*
+Remarks   : NULL if the flash has no cache
+            partition
+-------------------------------------------*/
+const esp_partition_t* imgcache_partition(void);
+
+/*-----------------------------------------
+Function  : imgcache_slots
+Input     : const esp_partition_t*
+Output    : uint32_t
+Remarks   : number of slots in the partition
+-------------------------------------------*/
+uint32_t imgcache_slots(const esp_partition_t* part);
+
+/*-----------------------------------------
+Function  : imgcache_header
+Input     : const esp_partition_t*, uint32_t,
+            image_cache_header_t*
+Output    : bool
+Remarks   : reads the header of a slot, false
+            if the slot is empty
+-------------------------------------------*/
+bool imgcache_header(const esp_partition_t* part, uint32_t slot, image_cache_header_t* header);
+
+/*-----------------------------------------
+Function  : imgcache_store
+Input     : const esp_partition_t*, uint32_t,
+            fs:FS, String, String, uint32_t,
+            uint32_t
+Output    : bool
+Remarks   : decodes the bitmap into the slot,
+            the slot is empty if this fails or
+            millis() reaches deadline first (0
+            for none)
+-------------------------------------------*/
+bool imgcache_store(const esp_partition_t* part, uint32_t slot, fs::FS &fs, String path, String filename, uint32_t file_hash, uint32_t deadline);
+
+/*-----------------------------------------
+Function  : imgcache_send
+Input     : const esp_partition_t*, uint32_t,
+            Epd&
+Output    : bool
+Remarks   : streams the frame of a slot to the
+            display, false if the slot is empty
+            or the CRC does not match. Display
+            needs to be awake and refreshed
+            afterwards
+-------------------------------------------*/
+bool imgcache_send(const esp_partition_t* part, uint32_t slot, Epd &epd);
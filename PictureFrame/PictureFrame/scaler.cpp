@@ -0,0 +1,103 @@
+#include "scaler.h"
+
+bool scaler_begin(scaler_t* scaler, uint32_t width, uint32_t height, bool letterbox){
+  //Source pixel per display pixel as ratio num/den, crop uses the smaller
+  //ratio to fill the display, letterbox the larger one to fit the image
+  uint32_t num;
+  uint32_t den;
+  bool widthlimits = ( ((uint64_t)width*EPD_HEIGHT) >= ((uint64_t)height*EPD_WIDTH) );
+  if(widthlimits == letterbox){
+    num = width;
+    den = EPD_WIDTH;
+  } else {
+    num = height;
+    den = EPD_HEIGHT;
+  }
+  if(num<den){
+    //Never scale up, smaller images are centered
+    num = 1;
+    den = 1;
+  }
+  scaler->outwidth = ((uint64_t)width*den)/num;
+  scaler->outheight = ((uint64_t)height*den)/num;
+  if(scaler->outwidth>EPD_WIDTH){
+    scaler->outwidth = EPD_WIDTH;
+  }
+  if(scaler->outheight>EPD_HEIGHT){
+    scaler->outheight = EPD_HEIGHT;
+  }
+  //Very thin images (1 x 8192) would get no line or column at all
+  if(0 == scaler->outwidth){
+    scaler->outwidth = 1;
+  }
+  if(0 == scaler->outheight){
+    scaler->outheight = 1;
+  }
+  scaler->windowwidth = ((uint64_t)scaler->outwidth*num)/den;
+  scaler->windowheight = ((uint64_t)scaler->outheight*num)/den;
+  //The window never grows past the source, the one line is averaged from all there is
+  if(scaler->windowwidth>width){
+    scaler->windowwidth = width;
+  }
+  if(scaler->windowheight>height){
+    scaler->windowheight = height;
+  }
+  scaler->windowx = (width-scaler->windowwidth)/2;
+  scaler->windowy = (height-scaler->windowheight)/2;
+  scaler->outx = (EPD_WIDTH-scaler->outwidth)/2;
+  scaler->outy = (EPD_HEIGHT-scaler->outheight)/2;
+  scaler->rows = 0;
+  scaler->sourcerow = 0;
+  scaler->outrow = 0;
+  scaler->sums = (uint32_t*)calloc(scaler->outwidth*3, sizeof(uint32_t));
+  scaler->columns = (uint32_t*)malloc( (scaler->outwidth+1)*sizeof(uint32_t) );
+  if( (NULL == scaler->sums) || (NULL == scaler->columns) ){
+    scaler_end(scaler);
+    return false;
+  }
+  for(uint32_t x=0;x<=scaler->outwidth;x++){
+    scaler->columns[x] = scaler->windowx + (((uint64_t)x*scaler->windowwidth)/scaler->outwidth);
+  }
+  return true;
+}
+
+bool scaler_add_row(scaler_t* scaler, const uint8_t* bgr, uint8_t* out){
+  uint32_t* sum = scaler->sums;
+  for(uint32_t x=0;x<scaler->outwidth;x++){
+    for(uint32_t i=scaler->columns[x];i<scaler->columns[x+1];i++){
+      sum[0] += bgr[(i*3)+0];
+      sum[1] += bgr[(i*3)+1];
+      sum[2] += bgr[(i*3)+2];
+    }
+    sum+=3;
+  }
+  scaler->rows++;
+  scaler->sourcerow++;
+  //Output line is done once all source lines that belong to it are summed up
+  uint32_t rowend = ( (uint64_t)(scaler->outrow+1)*scaler->windowheight )/scaler->outheight;
+  if(scaler->sourcerow<rowend){
+    return false;
+  }
+  memset(out, 0xFF, EPD_WIDTH*3);
+  sum = scaler->sums;
+  uint8_t* pixel = &out[scaler->outx*3];
+  for(uint32_t x=0;x<scaler->outwidth;x++){
+    uint32_t count = (scaler->columns[x+1]-scaler->columns[x])*scaler->rows;
+    for(uint8_t c=0;c<3;c++){
+      pixel[c] = (sum[c]+(count/2))/count;
+      sum[c] = 0;
+    }
+    sum+=3;
+    pixel+=3;
+  }
+  scaler->rows = 0;
+  scaler->outrow++;
+  return true;
+}
+
+void scaler_end(scaler_t* scaler){
+  free(scaler->sums);
+  free(scaler->columns);
+  scaler->sums = NULL;
+  scaler->columns = NULL;
+}
@@ -0,0 +1,55 @@
+#include <Arduino.h>
+#include "epd5in65f.h"
+
+/* true: show the whole image with white borders, false: fill the display and crop the image */
+#define SCALER_LETTERBOX false
+
+/* 
+  Box filter to bring an image to the display size, the source is never 
+  scaled up. Only the part of the source inside the window is used and 
+  ends up at outx/outy with outwidth x outheight pixel on the display.
+*/
+typedef struct{
+  uint32_t windowx;
+  uint32_t windowy;
+  uint32_t windowwidth;
+  uint32_t windowheight;
+  uint32_t outx;
+  uint32_t outy;
+  uint32_t outwidth;
+  uint32_t outheight;
+  uint32_t* columns;    //outwidth+1 entries, first source column of each output column
+  uint32_t* sums;       //outwidth*3 entries, sum of B,G,R for the current output line
+  uint32_t rows;        //source lines in sums
+  uint32_t sourcerow;   //source lines inside the window done so far
+  uint32_t outrow;      //output lines done so far
+} scaler_t;
+
+/*-----------------------------------------
+Function  : scaler_begin
+Input     : scaler_t*, uint32_t, uint32_t, bool
+Output    : bool
+Remarks   : calculates the window for a 
+            width x height source and allocates
+            the buffer for one output line
+-------------------------------------------*/
+bool scaler_begin(scaler_t* scaler, uint32_t width, uint32_t height, bool letterbox);
+
+/*-----------------------------------------
+Function  : scaler_add_row
+Input     : scaler_t*, const uint8_t*, uint8_t*
+Output    : bool
+Remarks   : adds one BGR source line that is 
+            inside the window, returns true if
+            a display line (EPD_WIDTH BGR pixel,
+            borders white) is complete in out
+-------------------------------------------*/
+bool scaler_add_row(scaler_t* scaler, const uint8_t* bgr, uint8_t* out);
+
+/*-----------------------------------------
+Function  : scaler_end
+Input     : scaler_t*
+Output    : none
+Remarks   : frees the buffer
+-------------------------------------------*/
+void scaler_end(scaler_t* scaler);
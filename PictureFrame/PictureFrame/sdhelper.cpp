@@ -151,3 +151,169 @@ File openFileAtIdx(fs::FS &fs, const char * path, uint32_t idx){
     }
     return file;
 }
+
+/*-----------------------------------------
+Function  : isImageFile
+Input     : const char*
+Output    : bool
+Remarks   : .bmp files, hidden files (also 
+            those of macOS) are skipped
+-------------------------------------------*/
+static bool isImageFile(const char * name){
+  size_t len = strlen(name);
+  if( (len < 5) || ('.' == name[0]) ){
+    return false;
+  }
+  return (0 == strcasecmp(&name[len-4], ".bmp"));
+}
+
+/*-----------------------------------------
+Function  : openImageByWalk
+Input     : fs::FS&, const char*, uint32_t
+Output    : File
+Remarks   : image idx in directory order, 
+            counted like the index, used if 
+            there is no index
+-------------------------------------------*/
+static File openImageByWalk(fs::FS &fs, const char * path, uint32_t idx){
+  File root = fs.open(path);
+  if( (!root) || (!root.isDirectory()) ){
+    DBGPRINT.println("Failed to open directory");
+    return File();
+  }
+  uint32_t current_idx = 0;
+  File file = root.openNextFile();
+  while(file){
+    const char * name = file.name();
+    if( (false == file.isDirectory()) && (true == isImageFile(name)) && (strlen(name) < IMAGE_INDEX_NAMELEN) ){
+      if(current_idx == idx){
+        DBGPRINT.printf("  FILE: %s  SIZE: %u (no index)\n", name, (uint32_t)file.size());
+        return file;
+      }
+      current_idx++;
+    }
+    file = root.openNextFile();
+  }
+  return File();
+}
+
+/*-----------------------------------------
+Function  : readIndexHeader
+Input     : fs::FS&, const char*, 
+            image_index_header_t*
+Output    : bool
+Remarks   : false if there is no index or 
+            it was not written completely
+-------------------------------------------*/
+static bool readIndexHeader(fs::FS &fs, const char * path, image_index_header_t* header){
+  File index = fs.open(String(path) + IMAGE_INDEX_FILE);
+  if(!index){
+    return false;
+  }
+  bool valid = (sizeof(image_index_header_t) == index.read((uint8_t*)header, sizeof(image_index_header_t))) &&
+               (IMAGE_INDEX_MAGIC == header->magic) &&
+               (index.size() == (sizeof(image_index_header_t) + header->count*sizeof(image_index_entry_t)));
+  index.close();
+  return valid;
+}
+
+/*-----------------------------------------
+Function  : buildImageIndex
+Input     : fs::FS&, const char*,
+            image_index_fingerprint_fn
+Output    : uint32_t
+Remarks   : walks the directory once and 
+            writes the index, the header is
+            written last so an interrupted
+            build is never valid. If the index
+            can't be written the images are
+            only counted, openImageAtIdx() then
+            walks the directory
+-------------------------------------------*/
+static uint32_t buildImageIndex(fs::FS &fs, const char * path, image_index_fingerprint_fn fingerprint){
+  uint32_t start = millis();
+  String indexpath = String(path) + IMAGE_INDEX_FILE;
+  File root = fs.open(path);
+  if( (!root) || (!root.isDirectory()) ){
+    DBGPRINT.println("Failed to open directory");
+    return 0;
+  }
+  File index = fs.open(indexpath, FILE_WRITE);
+  image_index_header_t header;
+  memset(&header, 0, sizeof(header));
+  bool written = (index) && (sizeof(header) == index.write((const uint8_t*)&header, sizeof(header)));
+
+  image_index_entry_t entry;
+  File file = root.openNextFile();
+  while(file){
+    const char * name = file.name();
+    if( (false == file.isDirectory()) && (true == isImageFile(name)) ){
+      if(strlen(name) >= IMAGE_INDEX_NAMELEN){
+        DBGPRINT.printf("Name too long for the index: %s\n", name);
+      } else {
+        memset(&entry, 0, sizeof(entry));
+        strcpy(entry.name, name);
+        entry.size = file.size();
+        written = written && (sizeof(entry) == index.write((const uint8_t*)&entry, sizeof(entry)));
+        header.count++;
+      }
+    }
+    file = root.openNextFile();
+  }
+  root.close();
+
+  if(true == written){
+    //All entries are on the volume, the header goes into space that is 
+    //already taken, so the fingerprint stays the same
+    header.magic = IMAGE_INDEX_MAGIC;
+    header.fingerprint = fingerprint();
+    written = index.seek(0) && (sizeof(header) == index.write((const uint8_t*)&header, sizeof(header)));
+  }
+  if(index){
+    index.close();
+  }
+  if(false == written){
+    //No stale index may be used with the count of this walk
+    fs.remove(indexpath.c_str());
+    DBGPRINT.printf("Failed to write index, %u images are found by walking the directory\n", header.count);
+    return header.count;
+  }
+  DBGPRINT.printf("Index with %u images build in %u ms\n", header.count, millis()-start);
+  return header.count;
+}
+
+uint32_t openImageIndex(fs::FS &fs, const char * path, bool rebuild, image_index_fingerprint_fn fingerprint){
+  image_index_header_t header;
+  bool valid = readIndexHeader(fs, path, &header) && (fingerprint() == header.fingerprint);
+  if( (false == valid) || (true == rebuild) ){
+    return buildImageIndex(fs, path, fingerprint);
+  }
+  return header.count;
+}
+
+File openImageAtIdx(fs::FS &fs, const char * path, uint32_t idx){
+  File file;
+  image_index_entry_t entry;
+  image_index_header_t header;
+  if(false == readIndexHeader(fs, path, &header)){
+    return openImageByWalk(fs, path, idx);
+  }
+  File index = fs.open(String(path) + IMAGE_INDEX_FILE);
+  bool found = (idx < header.count) && (index) && index.seek(sizeof(image_index_header_t) + idx*sizeof(image_index_entry_t)) &&
+               (sizeof(entry) == index.read((uint8_t*)&entry, sizeof(entry)));
+  index.close();
+  if(false == found){
+    DBGPRINT.printf("Index has no image %u\n", idx);
+    return file;
+  }
+  entry.name[IMAGE_INDEX_NAMELEN-1] = 0;
+  file = fs.open(String(path) + "/" + entry.name);
+  if( (file) && (file.size() != entry.size) ){
+    DBGPRINT.printf("%s has changed\n", entry.name);
+    file.close();
+  }
+  if(file){
+    DBGPRINT.printf("  FILE: %s  SIZE: %u\n", entry.name, entry.size);
+  }
+  return file;
+}
@@ -8,4 +8,56 @@ void writeFile(fs::FS &fs, const char * path, const char * message);
 void appendFile(fs::FS &fs, const char * path, const char * message);
 void renameFile(fs::FS &fs, const char * path1, const char * path2);
 void deleteFile(fs::FS &fs, const char * path);
-File openFileAtIdx(fs::FS &fs, const char * path, uint32_t idx);
\ No newline at end of file
+File openFileAtIdx(fs::FS &fs, const char * path, uint32_t idx);
+
+/* 
+  Index of the .bmp files in a directory, kept as <path>/.index on the
+  card: a header followed by one fixed size record per image, so an
+  image is found with one seek and one read. Without a usable index the
+  images are found by walking the directory
+*/
+#define IMAGE_INDEX_FILE    "/.index"
+#define IMAGE_INDEX_MAGIC   0x58444950UL   /// "PIDX"
+#define IMAGE_INDEX_NAMELEN 96
+
+typedef struct __attribute__((__packed__)){
+  uint32_t magic;
+  uint32_t count;
+  uint32_t fingerprint;   //of the volume when the index was build
+} image_index_header_t;
+
+/* 
+  Changes when files are added, removed or written, e.g. the used space
+  of the volume. FAT does not update the date of a directory
+*/
+typedef uint32_t (*image_index_fingerprint_fn)(void);
+
+typedef struct __attribute__((__packed__)){
+  char name[IMAGE_INDEX_NAMELEN];
+  uint32_t size;
+} image_index_entry_t;
+
+/*-----------------------------------------
+Function  : openImageIndex
+Input     : fs::FS&, const char*, bool,
+            image_index_fingerprint_fn
+Output    : uint32_t
+Remarks   : checks the index of path and 
+            builds it if it is missing, the
+            fingerprint differs or rebuild is
+            true, returns the number of images
+            (also if the index can't be written)
+-------------------------------------------*/
+uint32_t openImageIndex(fs::FS &fs, const char * path, bool rebuild, image_index_fingerprint_fn fingerprint);
+
+/*-----------------------------------------
+Function  : openImageAtIdx
+Input     : fs::FS&, const char*, uint32_t
+Output    : File
+Remarks   : opens the image idx of the index,
+            the file is closed if the image is
+            gone or has changed, the index needs
+            a rebuild then. Without a usable 
+            index the directory is walked
+-------------------------------------------*/
+File openImageAtIdx(fs::FS &fs, const char * path, uint32_t idx);
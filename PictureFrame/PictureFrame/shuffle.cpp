@@ -0,0 +1,61 @@
+#include "shuffle.h"
+
+/*
+  A Feistel network is a bijection on 0..2^(2*halfbits)-1 for any round
+  function. The smallest such domain holding count values is at most 
+  4 times larger, values outside 0..count-1 are fed through again
+  (cycle walking) until one is inside, that keeps it a bijection on 
+  0..count-1 and needs less than 4 passes on average
+*/
+
+/*-----------------------------------------
+Function  : shuffle_round
+Input     : uint32_t, uint32_t, uint32_t
+Output    : uint32_t
+Remarks   : round function, mixes one half 
+            with the seed and the round
+-------------------------------------------*/
+static uint32_t shuffle_round(uint32_t value, uint32_t seed, uint32_t round){
+    uint32_t h = value ^ seed ^ (round * 0x9E3779B9UL);
+    //Finalizer of MurmurHash3
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+    return h;
+}
+
+/*-----------------------------------------
+Function  : shuffle_feistel
+Input     : uint32_t, uint32_t, uint32_t
+Output    : uint32_t
+Remarks   : one pass through the network on
+            2*halfbits bits
+-------------------------------------------*/
+static uint32_t shuffle_feistel(uint32_t value, uint32_t halfbits, uint32_t seed){
+    uint32_t mask = (1UL<<halfbits)-1;
+    uint32_t left = (value >> halfbits) & mask;
+    uint32_t right = value & mask;
+    for(uint32_t round=0;round<SHUFFLE_ROUNDS;round++){
+      uint32_t next = left ^ (shuffle_round(right, seed, round) & mask);
+      left = right;
+      right = next;
+    }
+    return (left << halfbits) | right;
+}
+
+uint32_t shuffle_index(uint32_t idx, uint32_t count, uint32_t seed){
+    if( (count < 2) || (idx >= count) ){
+      return idx;
+    }
+    uint32_t halfbits = 1;
+    while( (halfbits < 16) && ((1UL<<(2*halfbits)) < count) ){
+      halfbits++;
+    }
+    uint32_t value = idx;
+    do {
+      value = shuffle_feistel(value, halfbits, seed);
+    } while(value >= count);
+    return value;
+}
@@ -0,0 +1,17 @@
+#include <Arduino.h>
+
+/* Feistel rounds, 4 give a well mixed order for any seed */
+#define SHUFFLE_ROUNDS 4
+
+/*-----------------------------------------
+Function  : shuffle_index
+Input     : uint32_t, uint32_t, uint32_t
+Output    : uint32_t
+Remarks   : position idx of a random order of
+            0..count-1, every seed gives another
+            order and every value comes exactly 
+            once for idx 0..count-1, no table is
+            needed so the cost does not grow with
+            count
+-------------------------------------------*/
+uint32_t shuffle_index(uint32_t idx, uint32_t count, uint32_t seed);
@@ -0,0 +1,223 @@
+#include "host.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+bool host_log = false;
+uint32_t host_psram_size = 0;
+HardwareSerial Serial;
+HardwareSerial Serial1;
+EspClass ESP;
+
+static const std::chrono::steady_clock::time_point host_start = std::chrono::steady_clock::now();
+static std::atomic<uint64_t> host_skipped_us(0);
+
+uint64_t host_time_us(void){
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-host_start).count();
+}
+
+void host_skip_us(uint64_t us){
+    host_skipped_us += us;
+}
+
+uint32_t micros(void){
+    return (uint32_t)(host_time_us()+host_skipped_us);
+}
+
+uint32_t millis(void){
+    return (uint32_t)((host_time_us()+host_skipped_us)/1000);
+}
+
+void delay(uint32_t ms){
+    host_skip_us((uint64_t)ms*1000);
+}
+
+void delayMicroseconds(uint32_t us){
+    host_skip_us(us);
+}
+
+size_t Print::write(uint8_t value){
+    return write(&value, 1);
+}
+
+size_t Print::write(const uint8_t* data, size_t len){
+    if(true == host_log){
+      fwrite(data, 1, len, stderr);
+    }
+    return len;
+}
+
+size_t Print::print(const char* text){
+    return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(int value){
+    return printf("%i", value);
+}
+
+size_t Print::print(unsigned value){
+    return printf("%u", value);
+}
+
+size_t Print::print(unsigned long value){
+    return printf("%lu", value);
+}
+
+size_t Print::print(float value, int digits){
+    return printf("%.*f", digits, value);
+}
+
+size_t Print::println(const char* text){
+    return print(text)+print("\r\n");
+}
+
+size_t Print::println(int value){
+    return print(value)+print("\r\n");
+}
+
+size_t Print::println(unsigned value){
+    return print(value)+print("\r\n");
+}
+
+size_t Print::println(unsigned long value){
+    return print(value)+print("\r\n");
+}
+
+int Print::printf(const char* format, ...){
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if(len < 0){
+      return len;
+    }
+    if(len >= (int)sizeof(buffer)){
+      len = sizeof(buffer)-1;
+    }
+    return write((const uint8_t*)buffer, len);
+}
+
+size_t Stream::readBytes(char* buffer, size_t len){
+    size_t count = 0;
+    while(count < len){
+      int value = read();
+      if(value < 0){
+        break;
+      }
+      buffer[count++] = (char)value;
+    }
+    return count;
+}
+
+void* ps_malloc(size_t size){
+    return malloc(size);
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps){
+    return malloc(size);
+}
+
+uint32_t esp_random(void){
+    return (uint32_t)rand() ^ ((uint32_t)rand()<<16);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len){
+    crc = ~crc;
+    for(uint32_t i=0;i<len;i++){
+      crc ^= buf[i];
+      for(uint8_t bit=0;bit<8;bit++){
+        crc = (crc>>1) ^ (0xEDB88320UL & (0-(crc&1)));
+      }
+    }
+    return ~crc;
+}
+
+/* FreeRTOS on threads, a queue is a mutex protected list of fixed size items */
+typedef struct {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque< std::vector<uint8_t> > items;
+  UBaseType_t length;
+  UBaseType_t itemsize;
+} host_queue_t;
+
+static std::mutex tasks_lock;
+static std::condition_variable tasks_ended;
+static uint32_t tasks_running = 0;
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* handle){
+    //The stack is taken from the heap like on the ESP32 so it shows in heaptrack
+    void* memory = malloc(stack);
+    {
+      std::lock_guard<std::mutex> lock(tasks_lock);
+      tasks_running++;
+    }
+    std::thread([task, memory, arg]{
+      task(arg);
+      free(memory);
+      std::lock_guard<std::mutex> lock(tasks_lock);
+      tasks_running--;
+      tasks_ended.notify_all();
+    }).detach();
+    if(NULL != handle){
+      *handle = NULL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* handle, BaseType_t core){
+    return xTaskCreate(task, name, stack, arg, prio, handle);
+}
+
+void vTaskDelete(TaskHandle_t task){
+    //The thread ends when the task function returns
+}
+
+void host_tasks_wait(void){
+    std::unique_lock<std::mutex> lock(tasks_lock);
+    tasks_ended.wait(lock, []{ return 0 == tasks_running; });
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemsize){
+    host_queue_t* queue = new host_queue_t;
+    queue->length = length;
+    queue->itemsize = itemsize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t wait){
+    host_queue_t* queue = (host_queue_t*)handle;
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if(false == queue->changed.wait_for(lock, std::chrono::milliseconds(wait), [queue]{ return queue->items.size() < queue->length; })){
+      return pdFALSE;
+    }
+    queue->items.emplace_back((const uint8_t*)item, (const uint8_t*)item+queue->itemsize);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t wait){
+    host_queue_t* queue = (host_queue_t*)handle;
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if(false == queue->changed.wait_for(lock, std::chrono::milliseconds(wait), [queue]{ return false == queue->items.empty(); })){
+      return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemsize);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+void vQueueDelete(QueueHandle_t handle){
+    delete (host_queue_t*)handle;
+}
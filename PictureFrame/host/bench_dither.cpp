@@ -0,0 +1,252 @@
+/*
+  Time per frame and quality of the dithering (user-005, user-007)
+
+  bench_dither [runs]
+
+  A 600 x 448 photo-like image is dithered with dither_row() of the 
+  sketch, two lines of int16 error and the nearest color table, and with
+  the straight forward version: error for the whole frame in float and a
+  CIELAB search for every pixel.
+
+  Then every mode of dither_row() is timed and compared to the source by
+  PSNR, once per pixel and once after a 5x5 box blur of both images. The
+  blurred one is closer to what is seen from a distance, a pattern that 
+  keeps the average color scores well there even if single pixel are off
+*/
+#include "../PictureFrame/dither.cpp"
+#include "bmpfile.h"
+#include "host.h"
+
+#define BENCH_WIDTH EPD_WIDTH
+#define BENCH_HEIGHT EPD_HEIGHT
+
+/* Blur for the low pass PSNR, (2*BENCH_BLUR_RADIUS+1)^2 pixel */
+#define BENCH_BLUR_RADIUS 2
+
+/*-----------------------------------------
+Function  : reference_fs
+Input     : const uint8_t*, uint8_t*
+Output    : uint32_t
+Remarks   : Floyd-Steinberg on a float copy
+            of the frame, output one display
+            color per pixel, returns the bytes
+            of buffer used
+-------------------------------------------*/
+static uint32_t reference_fs(const uint8_t* rgb, uint8_t* out){
+    uint32_t size = BENCH_WIDTH*BENCH_HEIGHT*3;
+    float* frame = (float*)malloc(size*sizeof(float));
+    for(uint32_t i=0;i<size;i++){
+      frame[i] = rgb[i];
+    }
+    lab_color_t palette[7];
+    for(uint8_t i=0;i<7;i++){
+      palette[i] = rgb_to_lab(dither_palette[i].r, dither_palette[i].g, dither_palette[i].b);
+    }
+    for(uint32_t y=0;y<BENCH_HEIGHT;y++){
+      for(uint32_t x=0;x<BENCH_WIDTH;x++){
+        float* p = &frame[((y*BENCH_WIDTH)+x)*3];
+        float c[3];
+        for(uint8_t i=0;i<3;i++){
+          c[i] = fminf(fmaxf(p[i], 0.0f), 255.0f);
+        }
+        uint8_t color = nearest_lab(rgb_to_lab(c[0], c[1], c[2]), palette);
+        out[(y*BENCH_WIDTH)+x] = color;
+        float error[3] = { c[0]-dither_palette[color].r, c[1]-dither_palette[color].g, c[2]-dither_palette[color].b };
+        for(uint8_t i=0;i<3;i++){
+          if(x+1 < BENCH_WIDTH){
+            p[3+i] += error[i]*7.0f/16.0f;
+          }
+          if(y+1 < BENCH_HEIGHT){
+            float* below = &frame[(((y+1)*BENCH_WIDTH)+x)*3];
+            if(x > 0){
+              below[i-3] += error[i]*3.0f/16.0f;
+            }
+            below[i] += error[i]*5.0f/16.0f;
+            if(x+1 < BENCH_WIDTH){
+              below[i+3] += error[i]*1.0f/16.0f;
+            }
+          }
+        }
+      }
+    }
+    free(frame);
+    return size*sizeof(float);
+}
+
+/*-----------------------------------------
+Function  : sketch_dither
+Input     : const uint8_t*, uint8_t*, 
+            dither_mode_t
+Output    : uint32_t
+Remarks   : dither_row() line by line like
+            the reader, output one display 
+            color per pixel, returns the bytes
+            of buffer used
+-------------------------------------------*/
+static uint32_t sketch_dither(const uint8_t* rgb, uint8_t* out, dither_mode_t mode){
+    dither_t dither;
+    uint8_t bgr[BENCH_WIDTH*3];
+    uint8_t line[BENCH_WIDTH/2];
+    if(false == dither_begin(&dither, BENCH_WIDTH, mode)){
+      return 0;
+    }
+    for(uint32_t y=0;y<BENCH_HEIGHT;y++){
+      const uint8_t* src = &rgb[y*BENCH_WIDTH*3];
+      for(uint32_t x=0;x<BENCH_WIDTH;x++){
+        bgr[(x*3)+0] = src[(x*3)+2];
+        bgr[(x*3)+1] = src[(x*3)+1];
+        bgr[(x*3)+2] = src[(x*3)+0];
+      }
+      dither_row(&dither, bgr, line);
+      //Line comes mirrored and packed for the display
+      for(uint32_t x=0;x<BENCH_WIDTH;x++){
+        uint32_t pos = BENCH_WIDTH-1-x;
+        out[(y*BENCH_WIDTH)+x] = ( (0 == (pos & 1)) ? (line[pos/2]>>4) : line[pos/2] ) & 0x0F;
+      }
+    }
+    dither_end(&dither);
+    return (DITHER_FLOYD_STEINBERG == mode) ? 2*(BENCH_WIDTH+2)*3*sizeof(int16_t) : 0;
+}
+
+static uint32_t sketch_fs(const uint8_t* rgb, uint8_t* out){
+    return sketch_dither(rgb, out, DITHER_FLOYD_STEINBERG);
+}
+
+static uint32_t sketch_bayer4(const uint8_t* rgb, uint8_t* out){
+    return sketch_dither(rgb, out, DITHER_BAYER4);
+}
+
+static uint32_t sketch_bayer8(const uint8_t* rgb, uint8_t* out){
+    return sketch_dither(rgb, out, DITHER_BAYER8);
+}
+
+static uint32_t sketch_blue_noise(const uint8_t* rgb, uint8_t* out){
+    return sketch_dither(rgb, out, DITHER_BLUE_NOISE);
+}
+
+/*-----------------------------------------
+Function  : blur
+Input     : const float*, float*
+Output    : none
+Remarks   : box blur of a RGB frame, the
+            window is cut at the borders
+-------------------------------------------*/
+static void blur(const float* in, float* out){
+    for(uint32_t y=0;y<BENCH_HEIGHT;y++){
+      for(uint32_t x=0;x<BENCH_WIDTH;x++){
+        float sum[3] = { 0, 0, 0 };
+        uint32_t count = 0;
+        for(int32_t dy=-BENCH_BLUR_RADIUS;dy<=BENCH_BLUR_RADIUS;dy++){
+          for(int32_t dx=-BENCH_BLUR_RADIUS;dx<=BENCH_BLUR_RADIUS;dx++){
+            int32_t sx = (int32_t)x+dx;
+            int32_t sy = (int32_t)y+dy;
+            if( (sx < 0) || (sy < 0) || (sx >= BENCH_WIDTH) || (sy >= BENCH_HEIGHT) ){
+              continue;
+            }
+            for(uint8_t i=0;i<3;i++){
+              sum[i] += in[(((sy*BENCH_WIDTH)+sx)*3)+i];
+            }
+            count++;
+          }
+        }
+        for(uint8_t i=0;i<3;i++){
+          out[(((y*BENCH_WIDTH)+x)*3)+i] = sum[i]/count;
+        }
+      }
+    }
+}
+
+/*-----------------------------------------
+Function  : psnr
+Input     : const float*, const float*
+Output    : double
+Remarks   : PSNR in dB of two RGB frames
+-------------------------------------------*/
+static double psnr(const float* a, const float* b){
+    double sum = 0;
+    uint32_t size = BENCH_WIDTH*BENCH_HEIGHT*3;
+    for(uint32_t i=0;i<size;i++){
+      double diff = a[i]-b[i];
+      sum += diff*diff;
+    }
+    double mse = sum/size;
+    return (mse > 0) ? 10.0*log10((255.0*255.0)/mse) : 99.0;
+}
+
+int main(int argc, char** argv){
+    uint32_t runs = (argc > 1) ? atoi(argv[1]) : 10;
+    if(0 == runs){
+      runs = 1;
+    }
+    static const struct {
+      const char* name;
+      uint32_t (*dither)(const uint8_t*, uint8_t*);
+    } versions[] = {
+      { "float frame, CIELAB search", reference_fs },
+      { "dither_row",                 sketch_fs    },
+    };
+    uint8_t* rgb = (uint8_t*)malloc(BENCH_WIDTH*BENCH_HEIGHT*3);
+    uint8_t* out = (uint8_t*)malloc(BENCH_WIDTH*BENCH_HEIGHT);
+    bmpfile_pattern(rgb, BENCH_WIDTH, BENCH_HEIGHT);
+    //The table is build on first use, not part of the time per frame
+    setup_nearest_lut();
+    printf("Floyd-Steinberg %ix%i, %u runs\n", BENCH_WIDTH, BENCH_HEIGHT, runs);
+    bool ok = true;
+    for(uint32_t i=0;i<sizeof(versions)/sizeof(versions[0]);i++){
+      uint64_t total = 0;
+      uint32_t bytes = 0;
+      for(uint32_t run=0;run<runs;run++){
+        uint64_t start = host_time_us();
+        bytes = versions[i].dither(rgb, out);
+        total += host_time_us()-start;
+      }
+      ok = ok && (0 != bytes);
+      printf("%-28s %8.2f ms per frame %8u bytes error buffer\n", versions[i].name, total/1000.0/runs, bytes);
+    }
+
+    static const struct {
+      const char* name;
+      uint32_t (*dither)(const uint8_t*, uint8_t*);
+    } modes[] = {
+      { "Floyd-Steinberg", sketch_fs         },
+      { "Bayer 4x4",       sketch_bayer4     },
+      { "Bayer 8x8",       sketch_bayer8     },
+      { "Blue noise",      sketch_blue_noise },
+    };
+    uint32_t size = BENCH_WIDTH*BENCH_HEIGHT*3;
+    float* source = (float*)malloc(size*sizeof(float));
+    float* sourceblur = (float*)malloc(size*sizeof(float));
+    float* result = (float*)malloc(size*sizeof(float));
+    float* resultblur = (float*)malloc(size*sizeof(float));
+    for(uint32_t i=0;i<size;i++){
+      source[i] = rgb[i];
+    }
+    blur(source, sourceblur);
+    printf("\nModes of dither_row(), PSNR against the source\n");
+    printf("%-16s %10s %10s %12s\n", "", "ms/frame", "PSNR dB", "blurred dB");
+    for(uint32_t i=0;i<sizeof(modes)/sizeof(modes[0]);i++){
+      uint64_t total = 0;
+      for(uint32_t run=0;run<runs;run++){
+        uint64_t start = host_time_us();
+        modes[i].dither(rgb, out);
+        total += host_time_us()-start;
+      }
+      //Shown as the conversion palette
+      for(uint32_t p=0;p<BENCH_WIDTH*BENCH_HEIGHT;p++){
+        ok = ok && (out[p] < 7);
+        const dither_color_t* color = &dither_palette[out[p] % 7];
+        result[(p*3)+0] = color->r;
+        result[(p*3)+1] = color->g;
+        result[(p*3)+2] = color->b;
+      }
+      blur(result, resultblur);
+      printf("%-16s %10.2f %10.2f %12.2f\n", modes[i].name, total/1000.0/runs, psnr(source, result), psnr(sourceblur, resultblur));
+    }
+    free(source);
+    free(sourceblur);
+    free(result);
+    free(resultblur);
+    free(rgb);
+    free(out);
+    return (true == ok) ? 0 : 1;
+}
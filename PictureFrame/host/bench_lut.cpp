@@ -0,0 +1,120 @@
+/*
+  Fused palette remap and mirror against the two loops it replaced (user-002)
+
+  bench_lut [runs]
+
+  The raw 4 bit data of _acBatteryEmpty (as it is in a bitmap file) is
+  converted to display order with convert_row() of the reader and with
+  the two passes over the frame the reader had before. Both results must
+  be the flash image
+*/
+#include "../PictureFrame/bmpreader.cpp"
+#include "images.h"
+#include "bmpfile.h"
+#include "host.h"
+
+#define LUT_BYTESPERLINE (EPD_WIDTH/2)
+#define LUT_FRAMESIZE (LUT_BYTESPERLINE*EPD_HEIGHT)
+
+/*-----------------------------------------
+Function  : two_loops
+Input     : uint8_t*
+Output    : none
+Remarks   : color change of the whole frame 
+            nibble by nibble, then mirroring
+            of every line, as before user-002
+-------------------------------------------*/
+static void two_loops(uint8_t* buffer){
+    uint32_t bytesperline = LUT_BYTESPERLINE;
+    for(uint32_t x=0;x<EPD_HEIGHT;x++){
+      for(uint32_t i=0;i<bytesperline;i++){
+        uint32_t offset = bytesperline*x;
+        uint8_t pixel_a[2];
+        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
+        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
+        pixel_a[0]=color_lut[pixel_a[0]].output;
+        pixel_a[1]=color_lut[pixel_a[1]].output;
+        buffer[offset+i]= ( (pixel_a[0]<<4) &0xF0) | (pixel_a[1]&0x0F);
+      }
+    }
+    for(uint32_t x=0;x<EPD_HEIGHT;x++){
+      for(uint32_t i=0;i<(bytesperline/2);i++){
+        uint32_t offset = bytesperline*x;
+        uint8_t pixel_a[2];
+        uint8_t pixel_b[2];
+        pixel_a[0]=(buffer[i+offset]>>4)&0x0F;
+        pixel_a[1]=(buffer[i+offset]>>0)&0x0F;
+        pixel_b[0]=(buffer[offset+bytesperline-1-i]>>4)&0x0F;
+        pixel_b[1]=(buffer[offset+bytesperline-1-i]>>0)&0x0F;
+        buffer[offset+bytesperline-1-i]= ( (pixel_a[1]<<4) &0xF0) | (pixel_a[0]&0x0F);
+        buffer[offset+i] = ( (pixel_b[1]<<4) &0xF0) | (pixel_b[0]&0x0F);
+      }
+    }
+}
+
+/*-----------------------------------------
+Function  : fused
+Input     : uint8_t*
+Output    : none
+Remarks   : convert_row() of the reader on
+            every line
+-------------------------------------------*/
+static void fused(uint8_t* buffer){
+    for(uint32_t x=0;x<EPD_HEIGHT;x++){
+      convert_row(&buffer[x*LUT_BYTESPERLINE], LUT_BYTESPERLINE);
+    }
+}
+
+/*-----------------------------------------
+Function  : bench
+Input     : const char*, void(*)(uint8_t*),
+            const uint8_t*, uint8_t*, uint32_t
+Output    : bool
+Remarks   : runs the kernel on a fresh copy
+            of source, the time per frame is
+            printed
+-------------------------------------------*/
+static bool bench(const char* name, void (*kernel)(uint8_t*), const uint8_t* source, uint8_t* buffer, uint32_t runs){
+    uint64_t total = 0;
+    for(uint32_t run=0;run<runs;run++){
+      memcpy(buffer, source, LUT_FRAMESIZE);
+      uint64_t start = host_time_us();
+      kernel(buffer);
+      total += host_time_us()-start;
+    }
+    bool ok = (0 == memcmp(buffer, _acBatteryEmpty, LUT_FRAMESIZE));
+    printf("%-12s %8.1f us per frame  %s\n", name, (double)total/runs, (true == ok) ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv){
+    uint32_t runs = (argc > 1) ? atoi(argv[1]) : 200;
+    if(0 == runs){
+      runs = 1;
+    }
+    //Bitmap palette with the conversion colors, maps every index to itself
+    BMP_Color_Pallette16_t palette;
+    memset(&palette, 0, sizeof(palette));
+    for(uint32_t i=0;i<8;i++){
+      palette.entry[i].color.r = bmpfile_epd_palette[i][0];
+      palette.entry[i].color.g = bmpfile_epd_palette[i][1];
+      palette.entry[i].color.b = bmpfile_epd_palette[i][2];
+    }
+    setup_color_lut(&palette);
+
+    //File data: same line order, every line mirrored back
+    uint8_t* source = (uint8_t*)malloc(LUT_FRAMESIZE);
+    uint8_t* buffer = (uint8_t*)malloc(LUT_FRAMESIZE);
+    for(uint32_t i=0;i<LUT_FRAMESIZE;i++){
+      uint32_t line = i/LUT_BYTESPERLINE;
+      uint32_t pos = i%LUT_BYTESPERLINE;
+      uint8_t value = _acBatteryEmpty[(line*LUT_BYTESPERLINE)+(LUT_BYTESPERLINE-1-pos)];
+      source[i] = (value<<4) | (value>>4);
+    }
+    printf("_acBatteryEmpty, %u runs\n", runs);
+    bool ok = bench("two loops", two_loops, source, buffer, runs);
+    ok = bench("convert_row", fused, source, buffer, runs) && ok;
+    free(source);
+    free(buffer);
+    return (true == ok) ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/*
+  Tiled portrait rotation against a per pixel scatter (user-009)
+
+  bench_rotate [runs]
+
+  A 448 x 600 4 bit frame is rotated with rotate_band() of the reader,
+  band by band as the reader does, and with a naive loop that walks the 
+  source once and writes every pixel to its place in the landscape frame.
+  Both results must be equal. The host caches are much larger than the
+  ESP32 ones, so the difference here is smaller than with the source in
+  PSRAM
+*/
+#include "../PictureFrame/bmpreader.cpp"
+#include "host.h"
+
+#define ROT_BYTESPERLINE (EPD_WIDTH/2)
+#define ROT_SRCSTRIDE (EPD_HEIGHT/2)
+#define ROT_FRAMESIZE (ROT_BYTESPERLINE*EPD_HEIGHT)
+
+/*-----------------------------------------
+Function  : naive_rotate
+Input     : const uint8_t*, uint8_t*
+Output    : none
+Remarks   : scatters every source pixel to
+            the landscape frame (file order)
+-------------------------------------------*/
+static void naive_rotate(const uint8_t* source, uint8_t* frame){
+    for(uint32_t sy=0;sy<EPD_WIDTH;sy++){
+      const uint8_t* srcline = &source[sy*ROT_SRCSTRIDE];
+      for(uint32_t sx=0;sx<EPD_HEIGHT;sx++){
+        #if BMP_PORTRAIT_ROTATION == 90
+        uint32_t y = EPD_HEIGHT-1-sx;
+        uint32_t x = sy;
+        #else
+        uint32_t y = sx;
+        uint32_t x = EPD_WIDTH-1-sy;
+        #endif
+        set_pixel(&frame[y*ROT_BYTESPERLINE], x, get_pixel(srcline, sx));
+      }
+    }
+}
+
+/*-----------------------------------------
+Function  : tiled_rotate
+Input     : const uint8_t*, uint8_t*
+Output    : none
+Remarks   : rotate_band() for all bands
+-------------------------------------------*/
+static void tiled_rotate(const uint8_t* source, uint8_t* frame){
+    for(uint32_t lines=0;lines<EPD_HEIGHT;lines+=BMP_ROTATE_BAND_LINES){
+      rotate_band(source, &frame[lines*ROT_BYTESPERLINE], lines, BMP_ROTATE_BAND_LINES);
+    }
+}
+
+int main(int argc, char** argv){
+    uint32_t runs = (argc > 1) ? atoi(argv[1]) : 200;
+    if(0 == runs){
+      runs = 1;
+    }
+    static const struct {
+      const char* name;
+      void (*rotate)(const uint8_t*, uint8_t*);
+    } kernels[] = {
+      { "naive scatter", naive_rotate },
+      { "rotate_band",   tiled_rotate },
+    };
+    uint8_t* source = (uint8_t*)malloc(ROT_FRAMESIZE);
+    uint8_t* frames[2];
+    for(uint32_t i=0;i<ROT_FRAMESIZE;i++){
+      source[i] = esp_random();
+    }
+    printf("448x600 to 600x448, %u degree, %u runs\n", BMP_PORTRAIT_ROTATION, runs);
+    for(uint32_t i=0;i<2;i++){
+      frames[i] = (uint8_t*)calloc(ROT_FRAMESIZE, 1);
+      uint64_t total = 0;
+      for(uint32_t run=0;run<runs;run++){
+        uint64_t start = host_time_us();
+        kernels[i].rotate(source, frames[i]);
+        total += host_time_us()-start;
+      }
+      printf("%-14s %8.1f us per frame\n", kernels[i].name, (double)total/runs);
+    }
+    bool ok = (0 == memcmp(frames[0], frames[1], ROT_FRAMESIZE));
+    printf("%s\n", (true == ok) ? "Results are equal" : "Results differ, FAILED");
+    free(source);
+    free(frames[0]);
+    free(frames[1]);
+    return (true == ok) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/*
+  Peak heap and time of the streaming display path (user-001)
+
+  bench_stream [runs]
+
+  The flash images of images.h are written back as 4 bit bitmaps and a
+  photo-like 24 bit bitmap is generated, each one is shown with
+  load_bitmap_for_epd() on the controller stand-in. The frame the 
+  stand-in holds must be byte for byte the flash image. Heap is what the
+  path allocates with malloc/calloc/realloc including the decode task 
+  stack, the old path needed a frame buffer of EPD_WIDTH/2 x EPD_HEIGHT
+  bytes on top of the file read
+*/
+#include <Arduino.h>
+#include <sys/stat.h>
+#include "FS.h"
+#include "epd5in65f.h"
+#include "bmpreader.h"
+#include "images.h"
+#include "bmpfile.h"
+#include "heaptrack.h"
+#include "panel.h"
+#include "host.h"
+
+#define BENCH_DIR "build/bench_images"
+
+/*-----------------------------------------
+Function  : display_to_index
+Input     : const uint8_t*, uint8_t*
+Output    : none
+Remarks   : display frame (bottom line first, 
+            lines mirrored) to one palette
+            index per pixel, top line first
+-------------------------------------------*/
+static void display_to_index(const uint8_t* frame, uint8_t* index){
+    for(uint32_t y=0;y<EPD_HEIGHT;y++){
+      const uint8_t* line = &frame[(EPD_HEIGHT-1-y)*(EPD_WIDTH/2)];
+      for(uint32_t x=0;x<EPD_WIDTH;x++){
+        uint32_t pos = EPD_WIDTH-1-x;
+        index[(y*EPD_WIDTH)+x] = ( (0 == (pos & 1)) ? (line[pos/2]>>4) : line[pos/2] ) & 0x07;
+      }
+    }
+}
+
+/*-----------------------------------------
+Function  : bench
+Input     : const char*, const uint8_t*,
+            uint32_t
+Output    : bool
+Remarks   : shows the bitmap runs times, the
+            frame is compared if expected is
+            not NULL
+-------------------------------------------*/
+static bool bench(const char* name, const uint8_t* expected, uint32_t runs){
+    FS fs(BENCH_DIR);
+    bool ok = true;
+    uint64_t total = 0;
+    size_t peak = 0;
+    for(uint32_t run=0;run<runs;run++){
+      epdsim_t sim;
+      epdsim_begin(&sim);
+      panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+      Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+      epd.Init();
+      ok = ok && (EPD_OK == epd.Wake());
+      host_tasks_wait();
+      heaptrack_reset();
+      uint64_t start = host_time_us();
+      ok = ok && load_bitmap_for_epd(fs, "", name, epd);
+      total += host_time_us()-start;
+      if(heaptrack_peak() > peak){
+        peak = heaptrack_peak();
+      }
+      ok = ok && (EPD_OK == epd.EPD_5IN65F_Refresh());
+      epd.Sleep();
+      if( (NULL != expected) && (0 != memcmp(sim.frame, expected, (EPD_WIDTH/2)*EPD_HEIGHT)) ){
+        fprintf(stderr, "%s: frame differs from the flash image\n", name);
+        ok = false;
+      }
+      ok = ok && (0 == sim.errors);
+      panel_attach(NULL, -1, -1, -1, -1);
+      epdsim_end(&sim);
+    }
+    printf("%-24s %8.2f ms %8u bytes peak heap  %s\n", name, total/1000.0/runs, (unsigned)peak, (true == ok) ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv){
+    uint32_t runs = (argc > 1) ? atoi(argv[1]) : 10;
+    if(0 == runs){
+      runs = 1;
+    }
+    mkdir(BENCH_DIR, 0755);
+    static const struct {
+      const char* name;
+      const uint8_t* frame;
+    } assets[] = {
+      { "_acBatteryEmpty.bmp", _acBatteryEmpty },
+      { "_acNo_Sd_Card.bmp",   _acNo_Sd_Card   },
+    };
+    uint8_t* index = (uint8_t*)malloc(EPD_WIDTH*EPD_HEIGHT);
+    bool ok = true;
+    for(uint32_t i=0;i<sizeof(assets)/sizeof(assets[0]);i++){
+      display_to_index(assets[i].frame, index);
+      ok = ok && bmpfile_write4((std::string(BENCH_DIR "/")+assets[i].name).c_str(), index, EPD_WIDTH, EPD_HEIGHT, 
+                                &bmpfile_epd_palette[0][0], 8, false, false);
+    }
+    free(index);
+    uint8_t* rgb = (uint8_t*)malloc(EPD_WIDTH*EPD_HEIGHT*3);
+    bmpfile_pattern(rgb, EPD_WIDTH, EPD_HEIGHT);
+    ok = ok && bmpfile_write24(BENCH_DIR "/photo_600x448.bmp", rgb, EPD_WIDTH, EPD_HEIGHT, false);
+    free(rgb);
+    if(false == ok){
+      fprintf(stderr, "Can't write the images to " BENCH_DIR "\n");
+      return 1;
+    }
+
+    printf("Streaming path, %u runs, SPI transfers take no time\n", runs);
+    printf("The old frame buffer path needed another %u bytes of PSRAM\n", (unsigned)((EPD_WIDTH/2)*EPD_HEIGHT));
+    for(uint32_t i=0;i<sizeof(assets)/sizeof(assets[0]);i++){
+      ok = bench(assets[i].name, assets[i].frame, runs) && ok;
+    }
+    ok = bench("photo_600x448.bmp", NULL, runs) && ok;
+    return (true == ok) ? 0 : 1;
+}
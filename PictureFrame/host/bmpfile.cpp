@@ -0,0 +1,196 @@
+#include "bmpfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+const uint8_t bmpfile_epd_palette[8][3] = {
+  { 0x00, 0x00, 0x00 },  //Black
+  { 0xFF, 0xFF, 0xFF },  //White
+  { 0x22, 0xB1, 0x4C },  //Green
+  { 0x3F, 0x48, 0xCC },  //Blue
+  { 0xED, 0x1C, 0x24 },  //Red
+  { 0xFF, 0xF2, 0x00 },  //Yellow
+  { 0xFF, 0x7F, 0x27 },  //Orange
+  { 0xFF, 0xE2, 0x82 }   //Transparent
+};
+
+static void put16(uint8_t* p, uint16_t value){
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value){
+    put16(p, value & 0xFFFF);
+    put16(p+2, value >> 16);
+}
+
+/*-----------------------------------------
+Function  : write_file
+Input     : const char*, uint32_t, uint32_t,
+            uint16_t, uint32_t, const uint8_t*,
+            uint32_t, const uint8_t*, uint32_t,
+            bool
+Output    : bool
+Remarks   : headers, palette and data
+-------------------------------------------*/
+static bool write_file(const char* path, uint32_t width, uint32_t height, uint16_t bits, uint32_t compression,
+                       const uint8_t* palette, uint32_t colors, const uint8_t* data, uint32_t datasize, bool topdown){
+    uint8_t header[54];
+    memset(header, 0, sizeof(header));
+    uint32_t offset = sizeof(header)+(colors*4);
+    header[0] = 'B';
+    header[1] = 'M';
+    put32(&header[2], offset+datasize);
+    put32(&header[10], offset);
+    put32(&header[14], 40);
+    put32(&header[18], width);
+    put32(&header[22], (true == topdown) ? (uint32_t)(-(int32_t)height) : height);
+    put16(&header[26], 1);
+    put16(&header[28], bits);
+    put32(&header[30], compression);
+    put32(&header[34], datasize);
+    put32(&header[38], 2835);
+    put32(&header[42], 2835);
+    put32(&header[46], colors);
+    FILE* file = fopen(path, "wb");
+    if(NULL == file){
+      return false;
+    }
+    bool ok = (sizeof(header) == fwrite(header, 1, sizeof(header), file));
+    for(uint32_t i=0;i<colors;i++){
+      uint8_t entry[4] = { palette[(i*3)+2], palette[(i*3)+1], palette[(i*3)+0], 0 };
+      ok = ok && (4 == fwrite(entry, 1, 4, file));
+    }
+    ok = ok && (datasize == fwrite(data, 1, datasize, file));
+    return (0 == fclose(file)) && ok;
+}
+
+void bmpfile_pattern(uint8_t* rgb, uint32_t width, uint32_t height){
+    for(uint32_t y=0;y<height;y++){
+      for(uint32_t x=0;x<width;x++){
+        uint8_t* p = &rgb[((y*width)+x)*3];
+        float fx = (float)x/width;
+        float fy = (float)y/height;
+        if(fy < 0.25f){
+          //Hue sweep with falling saturation
+          float h = fx*6.0f;
+          float s = 1.0f-(fy*4.0f);
+          float c[3];
+          c[0] = fminf(fmaxf(fabsf(h-3.0f)-1.0f, 0.0f), 1.0f);
+          c[1] = fminf(fmaxf(2.0f-fabsf(h-2.0f), 0.0f), 1.0f);
+          c[2] = fminf(fmaxf(2.0f-fabsf(h-4.0f), 0.0f), 1.0f);
+          for(int i=0;i<3;i++){
+            p[i] = (uint8_t)(255.0f*((c[i]*s)+(1.0f-s)));
+          }
+        } else if(fy < 0.5f){
+          //Grey ramp
+          p[0] = p[1] = p[2] = (uint8_t)(255.0f*fx);
+        } else {
+          //Sky, ground and a sun
+          float dx = fx-0.7f;
+          float dy = fy-0.65f;
+          if( ((dx*dx)+(dy*dy)) < 0.01f ){
+            p[0] = 250; p[1] = 210; p[2] = 60;
+          } else if(fy < 0.75f){
+            p[0] = (uint8_t)(90+(100*fy)); p[1] = (uint8_t)(150+(80*fy)); p[2] = 230;
+          } else {
+            p[0] = (uint8_t)(60+(60*fx)); p[1] = (uint8_t)(140-(50*fy)); p[2] = (uint8_t)(40+(30*fx));
+          }
+        }
+      }
+    }
+}
+
+void bmpfile_epd_pattern(uint8_t* index, uint32_t width, uint32_t height){
+    for(uint32_t y=0;y<height;y++){
+      for(uint32_t x=0;x<width;x++){
+        uint8_t value;
+        if(y < height/4){
+          value = (x*7)/width;                //Color bars
+        } else if(y < height/2){
+          value = ((x/8)+(y/8)) % 7;          //Checkerboard of all colors
+        } else {
+          value = ((x/3)+(y/5)+(x*y/97)) % 7; //Small and odd structures
+        }
+        index[(y*width)+x] = value;
+      }
+    }
+}
+
+bool bmpfile_write24(const char* path, const uint8_t* rgb, uint32_t width, uint32_t height, bool topdown){
+    uint32_t stride = ((width*3)+3) & ~3UL;
+    uint8_t* data = (uint8_t*)calloc(stride, height);
+    for(uint32_t line=0;line<height;line++){
+      uint32_t y = (true == topdown) ? line : (height-1-line);
+      for(uint32_t x=0;x<width;x++){
+        const uint8_t* p = &rgb[((y*width)+x)*3];
+        data[(line*stride)+(x*3)+0] = p[2];
+        data[(line*stride)+(x*3)+1] = p[1];
+        data[(line*stride)+(x*3)+2] = p[0];
+      }
+    }
+    bool ok = write_file(path, width, height, 24, 0, NULL, 0, data, stride*height, topdown);
+    free(data);
+    return ok;
+}
+
+bool bmpfile_write8(const char* path, const uint8_t* rgb, uint32_t width, uint32_t height){
+    uint8_t palette[256*3];
+    for(uint32_t i=0;i<256;i++){
+      palette[(i*3)+0] = ((i>>5)*255)/7;
+      palette[(i*3)+1] = (((i>>2)&7)*255)/7;
+      palette[(i*3)+2] = ((i&3)*255)/3;
+    }
+    uint32_t stride = (width+3) & ~3UL;
+    uint8_t* data = (uint8_t*)calloc(stride, height);
+    for(uint32_t line=0;line<height;line++){
+      uint32_t y = height-1-line;
+      for(uint32_t x=0;x<width;x++){
+        const uint8_t* p = &rgb[((y*width)+x)*3];
+        data[(line*stride)+x] = (((p[0]*7)+127)/255<<5) | (((p[1]*7)+127)/255<<2) | ((p[2]*3)+127)/255;
+      }
+    }
+    bool ok = write_file(path, width, height, 8, 0, palette, 256, data, stride*height, false);
+    free(data);
+    return ok;
+}
+
+bool bmpfile_write4(const char* path, const uint8_t* index, uint32_t width, uint32_t height,
+                    const uint8_t* palette, uint32_t colors, bool topdown, bool rle4){
+    uint32_t stride = (((width+1)/2)+3) & ~3UL;
+    //RLE4 needs at most 2 bytes per pixel plus the line end
+    uint8_t* data = (uint8_t*)calloc((width*2)+stride+2, height+1);
+    uint32_t size = 0;
+    for(uint32_t line=0;line<height;line++){
+      uint32_t y = (true == topdown) ? line : (height-1-line);
+      const uint8_t* src = &index[y*width];
+      if(false == rle4){
+        for(uint32_t x=0;x<width;x++){
+          data[size+(x/2)] |= (0 == (x&1)) ? (src[x]<<4) : src[x];
+        }
+        size += stride;
+        continue;
+      }
+      //Encoded runs of one color, at most 255 pixel each
+      uint32_t x = 0;
+      while(x < width){
+        uint32_t run = 1;
+        while( ((x+run) < width) && (src[x+run] == src[x]) && (run < 255) ){
+          run++;
+        }
+        data[size++] = run;
+        data[size++] = (src[x]<<4) | src[x];
+        x += run;
+      }
+      data[size++] = 0;
+      data[size++] = 0;
+    }
+    if(true == rle4){
+      data[size++] = 0;
+      data[size++] = 1;
+    }
+    bool ok = write_file(path, width, height, 4, (true == rle4) ? 2 : 0, palette, colors, data, size, topdown);
+    free(data);
+    return ok;
+}
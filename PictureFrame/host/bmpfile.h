@@ -0,0 +1,68 @@
+#ifndef __BMPFILE_H__
+#define __BMPFILE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Writes test bitmaps in the formats the reader takes */
+
+/* The 7 colors of the conversion palette (eink-7color.bmp) and the one the
+   reader maps to transparent, index is the display color */
+extern const uint8_t bmpfile_epd_palette[8][3];
+
+/*-----------------------------------------
+Function  : bmpfile_pattern
+Input     : uint8_t*, uint32_t, uint32_t
+Output    : none
+Remarks   : fills width x height RGB pixel
+            (top line first) with gradients, 
+            color bars and circles, something
+            like a photo to dither
+-------------------------------------------*/
+void bmpfile_pattern(uint8_t* rgb, uint32_t width, uint32_t height);
+
+/*-----------------------------------------
+Function  : bmpfile_write24
+Input     : const char*, const uint8_t*, 
+            uint32_t, uint32_t, bool
+Output    : bool
+Remarks   : 24 bit bitmap from RGB pixel, 
+            top line first in rgb
+-------------------------------------------*/
+bool bmpfile_write24(const char* path, const uint8_t* rgb, uint32_t width, uint32_t height, bool topdown);
+
+/*-----------------------------------------
+Function  : bmpfile_write8
+Input     : const char*, const uint8_t*, 
+            uint32_t, uint32_t
+Output    : bool
+Remarks   : 8 bit bitmap, RGB pixel are 
+            reduced to 3-3-2 bit
+-------------------------------------------*/
+bool bmpfile_write8(const char* path, const uint8_t* rgb, uint32_t width, uint32_t height);
+
+/*-----------------------------------------
+Function  : bmpfile_write4
+Input     : const char*, const uint8_t*, 
+            uint32_t, uint32_t, const uint8_t*,
+            uint32_t, bool, bool
+Output    : bool
+Remarks   : 4 bit bitmap from palette indices
+            (one byte per pixel, top line
+            first), palette has colors RGB
+            entries, optional top-down or RLE4
+-------------------------------------------*/
+bool bmpfile_write4(const char* path, const uint8_t* index, uint32_t width, uint32_t height,
+                    const uint8_t* palette, uint32_t colors, bool topdown, bool rle4);
+
+/*-----------------------------------------
+Function  : bmpfile_epd_pattern
+Input     : uint8_t*, uint32_t, uint32_t
+Output    : none
+Remarks   : fills palette indices 0..6 in 
+            blocks and stripes, used with
+            bmpfile_epd_palette
+-------------------------------------------*/
+void bmpfile_epd_pattern(uint8_t* index, uint32_t width, uint32_t height);
+
+#endif
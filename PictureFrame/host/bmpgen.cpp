@@ -0,0 +1,133 @@
+/*
+  Writes the test images for make check into a directory
+
+  bmpgen dir
+
+  epd_*.bmp use only the 7 display colors and must show exactly as
+  epd_expected.ppm (the portrait one after the clockwise turn), the 
+  photo_*.bmp are dithered and scaled, cut_*.bmp end early and must 
+  still be shown, with the rest white
+*/
+#include <Arduino.h>
+#include "bmpfile.h"
+#include "epdsim.h"
+
+/*-----------------------------------------
+Function  : write_expected
+Input     : const char*, const uint8_t*
+Output    : bool
+Remarks   : the frame the controller must
+            hold for the 600 x 448 pattern,
+            written through the stand-in
+-------------------------------------------*/
+static bool write_expected(const char* path, const uint8_t* index){
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    //Line 0 is the bottom of the picture and every line is mirrored
+    for(uint32_t y=0;y<EPDSIM_HEIGHT;y++){
+      uint8_t* line = &sim.frame[(EPDSIM_HEIGHT-1-y)*(EPDSIM_WIDTH/2)];
+      for(uint32_t x=0;x<EPDSIM_WIDTH;x++){
+        uint32_t pos = EPDSIM_WIDTH-1-x;
+        uint8_t value = index[(y*EPDSIM_WIDTH)+x];
+        line[pos/2] = (0 == (pos & 1)) ? ((line[pos/2] & 0x0F) | (value<<4)) : ((line[pos/2] & 0xF0) | value);
+      }
+    }
+    FILE* out = fopen(path, "wb");
+    bool ok = (NULL != out) && (true == epdsim_write_ppm(&sim, out));
+    if( (NULL != out) && (0 != fclose(out)) ){
+      ok = false;
+    }
+    epdsim_end(&sim);
+    return ok;
+}
+
+/*-----------------------------------------
+Function  : write_cut
+Input     : const char*, const char*, uint32_t
+Output    : bool
+Remarks   : copies the first bytes of a file,
+            like a copy to the card that was
+            not finished
+-------------------------------------------*/
+static bool write_cut(const char* from, const char* to, uint32_t bytes){
+    FILE* in = fopen(from, "rb");
+    if(NULL == in){
+      return false;
+    }
+    uint8_t* data = (uint8_t*)malloc(bytes);
+    bool ok = (NULL != data) && (bytes == fread(data, 1, bytes, in));
+    fclose(in);
+    FILE* out = (true == ok) ? fopen(to, "wb") : NULL;
+    ok = (NULL != out) && (bytes == fwrite(data, 1, bytes, out));
+    if( (NULL != out) && (0 != fclose(out)) ){
+      ok = false;
+    }
+    free(data);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    if(argc != 2){
+      fprintf(stderr, "usage: %s dir\n", argv[0]);
+      return 2;
+    }
+    std::string dir = argv[1];
+    bool ok = true;
+
+    uint8_t* index = (uint8_t*)malloc(EPDSIM_WIDTH*EPDSIM_HEIGHT);
+    bmpfile_epd_pattern(index, EPDSIM_WIDTH, EPDSIM_HEIGHT);
+    const uint8_t* palette = &bmpfile_epd_palette[0][0];
+    ok = ok && bmpfile_write4((dir+"/epd_600x448.bmp").c_str(), index, EPDSIM_WIDTH, EPDSIM_HEIGHT, palette, 7, false, false);
+    ok = ok && bmpfile_write4((dir+"/epd_600x448_rle4.bmp").c_str(), index, EPDSIM_WIDTH, EPDSIM_HEIGHT, palette, 7, false, true);
+    ok = ok && bmpfile_write4((dir+"/epd_600x448_topdown.bmp").c_str(), index, EPDSIM_WIDTH, EPDSIM_HEIGHT, palette, 7, true, false);
+    ok = ok && write_expected((dir+"/epd_expected.ppm").c_str(), index);
+    //Portrait image that shows as the pattern after the clockwise turn (BMP_PORTRAIT_ROTATION 90)
+    uint8_t* portrait = (uint8_t*)malloc(EPDSIM_WIDTH*EPDSIM_HEIGHT);
+    for(uint32_t y=0;y<EPDSIM_WIDTH;y++){
+      for(uint32_t x=0;x<EPDSIM_HEIGHT;x++){
+        portrait[(y*EPDSIM_HEIGHT)+x] = index[(x*EPDSIM_WIDTH)+(EPDSIM_WIDTH-1-y)];
+      }
+    }
+    ok = ok && bmpfile_write4((dir+"/epd_448x600.bmp").c_str(), portrait, EPDSIM_HEIGHT, EPDSIM_WIDTH, palette, 7, false, false);
+    free(portrait);
+    free(index);
+
+    static const struct {
+      const char* name;
+      uint32_t width;
+      uint32_t height;
+      uint16_t bits;
+      bool topdown;
+    } photos[] = {
+      { "photo_600x448.bmp",         600,  448, 24, false },
+      { "photo_600x448_fs.bmp",      600,  448, 24, false },
+      { "photo_600x448_b4.bmp",      600,  448, 24, false },
+      { "photo_600x448_b8.bmp",      600,  448, 24, false },
+      { "photo_600x448_bn.bmp",      600,  448, 24, false },
+      { "photo_600x448_topdown.bmp", 600,  448, 24, true  },
+      { "photo_600x448_8bit.bmp",    600,  448,  8, false },
+      { "photo_448x600.bmp",         448,  600, 24, false },
+      { "photo_1024x768.bmp",       1024,  768, 24, false },
+      { "photo_333x201.bmp",         333,  201, 24, false },
+      { "photo_1x8192.bmp",            1, 8192, 24, false },
+      { "photo_8192x1.bmp",         8192,    1, 24, false },
+    };
+    for(uint32_t i=0;i<sizeof(photos)/sizeof(photos[0]);i++){
+      uint8_t* rgb = (uint8_t*)malloc(photos[i].width*photos[i].height*3);
+      bmpfile_pattern(rgb, photos[i].width, photos[i].height);
+      std::string path = dir+"/"+photos[i].name;
+      if(8 == photos[i].bits){
+        ok = ok && bmpfile_write8(path.c_str(), rgb, photos[i].width, photos[i].height);
+      } else {
+        ok = ok && bmpfile_write24(path.c_str(), rgb, photos[i].width, photos[i].height, photos[i].topdown);
+      }
+      free(rgb);
+    }
+    ok = ok && write_cut((dir+"/epd_600x448.bmp").c_str(), (dir+"/cut_600x448.bmp").c_str(), 100000);
+    ok = ok && write_cut((dir+"/photo_1024x768.bmp").c_str(), (dir+"/cut_1024x768.bmp").c_str(), 100000);
+    if(false == ok){
+      fprintf(stderr, "Can't write the images to %s\n", dir.c_str());
+      return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "SD_MMC.h"
+#include "Preferences.h"
+#include "Adafruit_LC709203F.h"
+#include "esp_partition.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <map>
+#include <vector>
+
+/*
+  The rest of the board for a host run of the whole sketch: the card is
+  a directory, the preferences and the cache partition stay in memory
+  over the boots of one run, the gas gauge gives a fixed charge
+*/
+#define HOST_CARD_CLUSTER 4096
+
+bool host_card_present = true;
+uint32_t host_card_mounts = 0;
+float host_battery_percent = 80.0f;
+uint32_t host_imgcache_size = 0;
+
+SDMMCFS SD_MMC(HOST_CARD_DIR);
+
+static std::map<std::string, std::vector<uint8_t> > preferences_store;
+static esp_partition_t imgcache_part;
+static std::vector<uint8_t> imgcache_flash;
+
+bool SDMMCFS::begin(const char* mountpoint, bool mode1bit, bool format_if_mount_failed, int sdmmc_frequency, uint8_t maxOpenFiles){
+    if(false == host_card_present){
+      return false;
+    }
+    mounted = true;
+    host_card_mounts++;
+    return true;
+}
+
+void SDMMCFS::end(void){
+    mounted = false;
+}
+
+uint8_t SDMMCFS::cardType(void){
+    return (true == mounted) ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDMMCFS::cardSize(void){
+    return 8ULL*1024*1024*1024;
+}
+
+/*-----------------------------------------
+Function  : used_bytes
+Input     : const std::string&
+Output    : uint64_t
+Remarks   : size of a directory tree in
+            whole clusters
+-------------------------------------------*/
+static uint64_t used_bytes(const std::string& path){
+    DIR* dir = opendir(path.c_str());
+    if(NULL == dir){
+      return 0;
+    }
+    uint64_t used = 0;
+    struct dirent* entry;
+    while(NULL != (entry = readdir(dir))){
+      if( (0 == strcmp(entry->d_name, ".")) || (0 == strcmp(entry->d_name, "..")) ){
+        continue;
+      }
+      std::string child = path + "/" + entry->d_name;
+      struct stat info;
+      if(0 != stat(child.c_str(), &info)){
+        continue;
+      }
+      if(S_ISDIR(info.st_mode)){
+        used += HOST_CARD_CLUSTER + used_bytes(child);
+      } else {
+        used += ((info.st_size+HOST_CARD_CLUSTER-1)/HOST_CARD_CLUSTER)*HOST_CARD_CLUSTER;
+      }
+    }
+    closedir(dir);
+    return used;
+}
+
+uint64_t SDMMCFS::usedBytes(void){
+    return used_bytes(hostpath("/"));
+}
+
+void host_preferences_clear(void){
+    preferences_store.clear();
+}
+
+bool Preferences::begin(const char* name, bool readonly){
+    this->name = std::string(name) + "/";
+    return true;
+}
+
+size_t Preferences::putULong(const char* key, uint32_t value){
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getULong(const char* key, uint32_t value){
+    getBytes(key, &value, sizeof(value));
+    return value;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value){
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t value){
+    getBytes(key, &value, sizeof(value));
+    return value;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len){
+    preferences_store[name+key].assign((const uint8_t*)value, (const uint8_t*)value+len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t len){
+    std::map<std::string, std::vector<uint8_t> >::iterator entry = preferences_store.find(name+key);
+    if( (preferences_store.end() == entry) || (entry->second.size() > len) ){
+      return 0;
+    }
+    memcpy(buffer, entry->second.data(), entry->second.size());
+    return entry->second.size();
+}
+
+bool Preferences::isKey(const char* key){
+    return preferences_store.end() != preferences_store.find(name+key);
+}
+
+bool Preferences::remove(const char* key){
+    return 0 != preferences_store.erase(name+key);
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label){
+    if( (0 == host_imgcache_size) || (ESP_PARTITION_TYPE_DATA != type) || (NULL == label) || (0 != strcmp(label, "imgcache")) ){
+      return NULL;
+    }
+    if(host_imgcache_size != imgcache_flash.size()){
+      //Erased flash
+      imgcache_flash.assign(host_imgcache_size, 0xFF);
+      imgcache_part.type = ESP_PARTITION_TYPE_DATA;
+      imgcache_part.subtype = 0x80;
+      imgcache_part.address = 0x400000;
+      imgcache_part.size = host_imgcache_size;
+      snprintf(imgcache_part.label, sizeof(imgcache_part.label), "%s", label);
+    }
+    return &imgcache_part;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t len){
+    if( (&imgcache_part != part) || (offset+len > imgcache_flash.size()) ){
+      return ESP_FAIL;
+    }
+    memcpy(dst, &imgcache_flash[offset], len);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t len){
+    if( (&imgcache_part != part) || (offset+len > imgcache_flash.size()) ){
+      return ESP_FAIL;
+    }
+    //Flash only clears bits, a write without an erase gives a mix
+    for(size_t i=0;i<len;i++){
+      imgcache_flash[offset+i] &= ((const uint8_t*)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t len){
+    if( (&imgcache_part != part) || (offset+len > imgcache_flash.size()) || (0 != (offset % 4096)) || (0 != (len % 4096)) ){
+      return ESP_FAIL;
+    }
+    memset(&imgcache_flash[offset], 0xFF, len);
+    return ESP_OK;
+}
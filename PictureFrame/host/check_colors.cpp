@@ -0,0 +1,104 @@
+/*
+  Nearest color mapping of the dithering (user-006)
+
+  check_colors
+
+  Every conversion palette color and all colors within +-CHECK_COLOR_RANGE
+  per channel around it must map to that display color, with
+  dither_nearest_color() (used for bitmap palettes) and with the table of
+  the dithering, which must also round to the closest level. A flat 
+  field of a palette color must give only that color with error 
+  diffusion, ordered modes spread every pixel on purpose. Some colors
+  seen wrong before are checked by name
+*/
+#include "../PictureFrame/dither.cpp"
+
+#define CHECK_COLOR_RANGE 8
+
+static const char* color_names[7] = { "black", "white", "green", "blue", "red", "yellow", "orange" };
+
+/*-----------------------------------------
+Function  : check_flat
+Input     : uint8_t, dither_mode_t
+Output    : bool
+Remarks   : dithers lines of one palette 
+            color, all pixel must be it
+-------------------------------------------*/
+static bool check_flat(uint8_t color, dither_mode_t mode){
+    uint8_t bgr[EPD_WIDTH*3];
+    uint8_t line[EPD_WIDTH/2];
+    for(uint32_t x=0;x<EPD_WIDTH;x++){
+      bgr[(x*3)+0] = dither_palette[color].b;
+      bgr[(x*3)+1] = dither_palette[color].g;
+      bgr[(x*3)+2] = dither_palette[color].r;
+    }
+    dither_t dither;
+    if(false == dither_begin(&dither, EPD_WIDTH, mode)){
+      return false;
+    }
+    bool ok = true;
+    for(uint32_t y=0;(y<64) && (true == ok);y++){
+      dither_row(&dither, bgr, line);
+      for(uint32_t i=0;i<EPD_WIDTH/2;i++){
+        ok = ok && (line[i] == ((color<<4) | color));
+      }
+    }
+    dither_end(&dither);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    bool ok = true;
+    setup_nearest_lut();
+    //Table level k stands for k*255/15, every value must use the closest one
+    uint32_t levels = 0;
+    for(int16_t v=0;v<=255;v++){
+      int16_t level = NEAREST_LUT_LEVEL(v);
+      int16_t distance = abs((level*255/((1<<NEAREST_LUT_BITS)-1))-v);
+      levels += (distance > (255/((1<<NEAREST_LUT_BITS)-1))/2) ? 1 : 0;
+    }
+    printf("Table levels: %u values not on the closest level %s\n", levels, (0 == levels) ? "ok" : "FAILED");
+    ok = ok && (0 == levels);
+    for(uint8_t color=0;color<7;color++){
+      uint32_t wrong = 0;
+      uint32_t wronglut = 0;
+      for(int16_t dr=-CHECK_COLOR_RANGE;dr<=CHECK_COLOR_RANGE;dr++){
+        for(int16_t dg=-CHECK_COLOR_RANGE;dg<=CHECK_COLOR_RANGE;dg++){
+          for(int16_t db=-CHECK_COLOR_RANGE;db<=CHECK_COLOR_RANGE;db++){
+            int16_t r = clamp_color(dither_palette[color].r+dr);
+            int16_t g = clamp_color(dither_palette[color].g+dg);
+            int16_t b = clamp_color(dither_palette[color].b+db);
+            wrong += (color != dither_nearest_color(r, g, b)) ? 1 : 0;
+            wronglut += (color != nearest_color(r, g, b)) ? 1 : 0;
+          }
+        }
+      }
+      bool flat = check_flat(color, DITHER_FLOYD_STEINBERG);
+      printf("%-7s +-%i: %u wrong, %u wrong in the table, flat field %s\n", color_names[color], CHECK_COLOR_RANGE, 
+             wrong, wronglut, (true == flat) ? "ok" : "FAILED");
+      ok = ok && (0 == wrong) && (0 == wronglut) && (true == flat);
+    }
+
+    static const struct {
+      uint8_t r;
+      uint8_t g;
+      uint8_t b;
+      uint8_t color;
+      uint8_t other;   //also fine
+    } named[] = {
+      { 236,  30,  36, EPD_5IN65F_RED,   EPD_5IN65F_RED   },
+      { 255,   0,   0, EPD_5IN65F_RED,   EPD_5IN65F_RED   },
+      { 200,   0,   0, EPD_5IN65F_RED,   EPD_5IN65F_RED   },
+      {  30, 180,  80, EPD_5IN65F_GREEN, EPD_5IN65F_GREEN },
+      {   0, 255,   0, EPD_5IN65F_GREEN, EPD_5IN65F_GREEN },
+      {   0,   0, 255, EPD_5IN65F_BLUE,  EPD_5IN65F_BLUE  },
+      { 128, 128, 128, EPD_5IN65F_WHITE, EPD_5IN65F_BLACK },
+    };
+    for(uint32_t i=0;i<sizeof(named)/sizeof(named[0]);i++){
+      uint8_t color = dither_nearest_color(named[i].r, named[i].g, named[i].b);
+      bool good = (color == named[i].color) || (color == named[i].other);
+      printf("(%3u,%3u,%3u) -> %-7s %s\n", named[i].r, named[i].g, named[i].b, color_names[color], (true == good) ? "ok" : "FAILED");
+      ok = ok && good;
+    }
+    return (true == ok) ? 0 : 1;
+}
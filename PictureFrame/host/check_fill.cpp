@@ -0,0 +1,130 @@
+/*
+  Frames of Epd without a bitmap on the controller stand-in (user-020)
+
+  check_fill
+
+  Every pattern of Epd::Fill(), Epd::Clear() in all colors and
+  EPD_5IN65F_Display() of a frame buffer are shown, the frame must be
+  the one built here pixel by pixel, with one refresh and no protocol
+  error for each
+*/
+#include <Arduino.h>
+#include "epd5in65f.h"
+#include "panel.h"
+
+typedef struct {
+  const char* name;
+  epd_fill_t pattern;   //EPD_FILL_SOLID with image for EPD_5IN65F_Display()
+  uint8_t color;
+  uint8_t color2;
+  bool clear;           //Epd::Clear(color)
+} fill_case_t;
+
+/*-----------------------------------------
+Function  : expected_pixel
+Input     : const fill_case_t*, uint32_t, uint32_t
+Output    : uint8_t
+Remarks   : color of pixel x/y in the order
+            the lines are send
+-------------------------------------------*/
+static uint8_t expected_pixel(const fill_case_t* test, uint32_t x, uint32_t y){
+    bool oddrow = (0 != ((y/EPD_FILL_CELL) % 2));
+    bool oddcolumn = (0 != ((x/EPD_FILL_CELL) % 2));
+    switch(test->pattern){
+      case EPD_FILL_STRIPES:
+        return (true == oddrow) ? (test->color2 & 0x07) : (test->color & 0x07);
+      case EPD_FILL_CHECKER:
+        return (oddrow != oddcolumn) ? (test->color2 & 0x07) : (test->color & 0x07);
+      case EPD_FILL_CLEAN:
+        return EPD_5IN65F_CLEAN;
+      default:
+        return test->color & 0x07;
+    }
+}
+
+/*-----------------------------------------
+Function  : image_pixel
+Input     : uint32_t, uint32_t
+Output    : uint8_t
+Remarks   : color of the frame buffer for
+            EPD_5IN65F_Display(), diagonals
+            of all seven colors
+-------------------------------------------*/
+static uint8_t image_pixel(uint32_t x, uint32_t y){
+    return (x+3*y) % 7;
+}
+
+/*-----------------------------------------
+Function  : check
+Input     : const fill_case_t*, const uint8_t*
+Output    : bool
+Remarks   : shows one case, image is the frame
+            buffer or NULL for a fill
+-------------------------------------------*/
+static bool check(const fill_case_t* test, uint8_t* image){
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+    epd.Init();
+    bool ok = (EPD_OK == epd.Wake());
+    if(NULL != image){
+      ok = ok && (EPD_OK == epd.EPD_5IN65F_Display(image));
+    } else if(true == test->clear){
+      ok = ok && (EPD_OK == epd.Clear(test->color));
+    } else {
+      ok = ok && (EPD_OK == epd.Fill(test->pattern, test->color, test->color2));
+    }
+    epd.Sleep();
+
+    //The frame is kept in the order the lines are send
+    uint32_t wrong = 0;
+    for(uint32_t y=0;y<EPDSIM_HEIGHT;y++){
+      for(uint32_t x=0;x<EPDSIM_WIDTH;x++){
+        uint8_t value = sim.frame[y*(EPDSIM_WIDTH/2)+(x/2)];
+        value = (0 == (x & 1)) ? (value>>4) : (value & 0x0F);
+        uint8_t expected = (NULL != image) ? image_pixel(x, y) : expected_pixel(test, x, y);
+        if(value != expected){
+          wrong++;
+        }
+      }
+    }
+    ok = ok && (0 == wrong) && (1 == sim.refreshes) && (0 == sim.errors);
+    printf("%-24s %6u wrong pixels, %u refreshes, %u errors  %s\n", test->name, wrong, sim.refreshes, sim.errors, (true == ok) ? "ok" : "FAILED");
+    epdsim_end(&sim);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    static const fill_case_t fills[] = {
+      { "solid red",             EPD_FILL_SOLID,   EPD_5IN65F_RED,    EPD_5IN65F_WHITE,  false },
+      { "stripes blue/yellow",   EPD_FILL_STRIPES, EPD_5IN65F_BLUE,   EPD_5IN65F_YELLOW, false },
+      { "checker black/white",   EPD_FILL_CHECKER, EPD_5IN65F_BLACK,  EPD_5IN65F_WHITE,  false },
+      { "checker green/orange",  EPD_FILL_CHECKER, EPD_5IN65F_GREEN,  EPD_5IN65F_ORANGE, false },
+      { "clean",                 EPD_FILL_CLEAN,   EPD_5IN65F_RED,    EPD_5IN65F_WHITE,  false },
+      //Only the three color bits are send
+      { "stripes 0x0C/0x09",     EPD_FILL_STRIPES, 0x0C,              0x09,              false },
+    };
+    bool ok = true;
+    for(uint32_t i=0;i<sizeof(fills)/sizeof(fills[0]);i++){
+      ok = check(&fills[i], NULL) && ok;
+    }
+    static const char* names[] = { "black", "white", "green", "blue", "red", "yellow", "orange" };
+    for(uint8_t color=EPD_5IN65F_BLACK;color<=EPD_5IN65F_ORANGE;color++){
+      char name[32];
+      snprintf(name, sizeof(name), "clear %s", names[color]);
+      fill_case_t clear = { name, EPD_FILL_SOLID, color, EPD_5IN65F_WHITE, true };
+      ok = check(&clear, NULL) && ok;
+    }
+
+    uint8_t* image = (uint8_t*)malloc((EPDSIM_WIDTH/2)*EPDSIM_HEIGHT);
+    for(uint32_t y=0;y<EPDSIM_HEIGHT;y++){
+      for(uint32_t x=0;x<EPDSIM_WIDTH;x+=2){
+        image[y*(EPDSIM_WIDTH/2)+(x/2)] = (image_pixel(x, y)<<4) | image_pixel(x+1, y);
+      }
+    }
+    fill_case_t display = { "display frame buffer", EPD_FILL_SOLID, 0, 0, false };
+    ok = check(&display, image) && ok;
+    free(image);
+    return (true == ok) ? 0 : 1;
+}
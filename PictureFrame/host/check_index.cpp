@@ -0,0 +1,99 @@
+/*
+  Image index of sdhelper on a directory of the host (user-021)
+
+  check_index
+
+  The index must list the bitmaps of the directory and nothing else, it
+  is kept while the fingerprint stays the same and build again when it
+  changes. If the index can't be written every image must still be found
+  by walking the directory
+*/
+#include <Arduino.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <set>
+#include "FS.h"
+#include "sdhelper.h"
+
+#define CHECK_DIR "build/index_images"
+
+static uint32_t volume = 1;
+
+/*-----------------------------------------
+Function  : fingerprint
+Input     : none
+Output    : uint32_t
+Remarks   : stand-in for the used space
+-------------------------------------------*/
+static uint32_t fingerprint(void){
+    return volume;
+}
+
+/*-----------------------------------------
+Function  : touch
+Input     : const char*
+Output    : none
+Remarks   : creates a small file in the 
+            test directory
+-------------------------------------------*/
+static void touch(const char* name){
+    std::string path = std::string(CHECK_DIR "/images/") + name;
+    FILE* file = fopen(path.c_str(), "wb");
+    fprintf(file, "%s", name);
+    fclose(file);
+}
+
+/*-----------------------------------------
+Function  : check
+Input     : FS&, const char*, uint32_t
+Output    : bool
+Remarks   : the index (or the walk) gives 
+            every bitmap once
+-------------------------------------------*/
+static bool check(FS& fs, const char* text, uint32_t expected, bool rebuild){
+    uint32_t count = openImageIndex(fs, "/images", rebuild, fingerprint);
+    std::set<std::string> names;
+    bool ok = (expected == count);
+    for(uint32_t i=0;i<count;i++){
+      File file = openImageAtIdx(fs, "/images", i);
+      if(!file){
+        ok = false;
+        continue;
+      }
+      std::string name = file.name();
+      size_t len = name.size();
+      ok = ok && (len > 4) && (0 == strcasecmp(&name[len-4], ".bmp")) && ('.' != name[0]) && (0 == names.count(name));
+      names.insert(name);
+    }
+    ok = ok && (!openImageAtIdx(fs, "/images", count));
+    printf("%-40s %2u images  %s\n", text, count, (true == ok) ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv){
+    system("rm -rf " CHECK_DIR " && mkdir -p " CHECK_DIR "/images/sub.bmp");
+    FS fs(CHECK_DIR);
+    touch("a.bmp");
+    touch("B.BMP");
+    touch("c.bmp");
+    touch("notes.txt");
+    touch("._a.bmp");
+    bool ok = check(fs, "First build", 3, false);
+
+    //A new file is only seen with a new fingerprint or a rebuild
+    touch("d.bmp");
+    ok = check(fs, "Same fingerprint, index kept", 3, false) && ok;
+    volume++;
+    ok = check(fs, "New fingerprint, index build again", 4, false) && ok;
+    touch("e.bmp");
+    ok = check(fs, "Rebuild", 5, true) && ok;
+
+    //The index can't be written, a stale one must not be used
+    fs.remove("/images/.index");
+    fs.mkdir("/images/.index");
+    volume++;
+    ok = check(fs, "Index can't be written, walk", 5, false) && ok;
+    touch("f.bmp");
+    ok = check(fs, "Walk sees new files", 6, true) && ok;
+    return (true == ok) ? 0 : 1;
+}
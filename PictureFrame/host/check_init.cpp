@@ -0,0 +1,129 @@
+/*
+  Replays the init table of Epd::Wake() on the controller stand-in 
+  (user-019)
+
+  check_init
+
+  The commands and data Wake() sends must be the ones of the Waveshare
+  demo code it replaced, in the same order, with one CS assertion per
+  command and the 100 ms before the last command. This is checked for
+  controllers that pull BUSY low at once or late after the reset and 
+  keep it low for a short or a long time, none of them may see a 
+  command before the reset is done
+*/
+#include <Arduino.h>
+#include <vector>
+#include "epd5in65f.h"
+#include "panel.h"
+#include "host.h"
+
+/* Commands of the demo Wake(): command, number of data bytes, data */
+static const uint8_t demo_sequence[] = {
+    0x00, 2, 0xEF, 0x08,
+    0x01, 4, 0x37, 0x00, 0x23, 0x23,
+    0x03, 1, 0x00,
+    0x06, 3, 0xC7, 0xC7, 0x1D,
+    0x30, 1, 0x3C,
+    0x41, 1, 0x00,
+    0x50, 1, 0x37,
+    0x60, 1, 0x22,
+    0x61, 4, 0x02, 0x58, 0x01, 0xC0,
+    0xE3, 1, 0xAA,
+    0x50, 1, 0x37,
+};
+
+/* Time the demo waits between 0xE3 and the last command */
+#define DEMO_LAST_DELAY_MS 100
+
+typedef struct{
+  uint32_t time;
+  uint8_t command;
+  std::vector<uint8_t> data;
+} trace_entry_t;
+
+/*-----------------------------------------
+Function  : record
+Input     : void*, uint8_t, const uint8_t*,
+            uint32_t
+Output    : none
+Remarks   : trace of the stand-in, data is
+            added to the last command
+-------------------------------------------*/
+static void record(void* ctx, uint8_t command, const uint8_t* data, uint32_t len){
+    std::vector<trace_entry_t>* trace = (std::vector<trace_entry_t>*)ctx;
+    if( (NULL == data) || (true == trace->empty()) ){
+      trace->push_back(trace_entry_t());
+      trace->back().time = millis();
+      trace->back().command = command;
+    }
+    if(NULL != data){
+      trace->back().data.insert(trace->back().data.end(), data, data+len);
+    }
+}
+
+/*-----------------------------------------
+Function  : check
+Input     : uint32_t, uint32_t
+Output    : bool
+Remarks   : Wake() with a controller that
+            pulls BUSY low resetdelay ms after
+            the reset for resetms
+-------------------------------------------*/
+static bool check(uint32_t resetdelay, uint32_t resetms){
+    std::vector<trace_entry_t> trace;
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    sim.resetdelay = resetdelay;
+    sim.resetms = resetms;
+    sim.trace = record;
+    sim.tracectx = &trace;
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+    epd.Init();
+    uint32_t start = millis();
+    bool ok = (EPD_OK == epd.Wake());
+    uint32_t duration = millis()-start;
+
+    //Same commands and data as the demo
+    uint32_t pos = 0;
+    for(uint32_t i=0;i<trace.size();i++){
+      if( (pos >= sizeof(demo_sequence)) || (trace[i].command != demo_sequence[pos]) ||
+          (trace[i].data.size() != demo_sequence[pos+1]) ||
+          (0 != memcmp(trace[i].data.data(), &demo_sequence[pos+2], trace[i].data.size())) ){
+        fprintf(stderr, "Command %u (0x%02x) differs from the demo sequence\n", i, trace[i].command);
+        ok = false;
+        break;
+      }
+      pos += 2+demo_sequence[pos+1];
+    }
+    if(pos != sizeof(demo_sequence)){
+      fprintf(stderr, "Sequence ends after %u of %u bytes\n", pos, (unsigned)sizeof(demo_sequence));
+      ok = false;
+    }
+    if( (trace.size() >= 2) && ( (trace[trace.size()-1].time-trace[trace.size()-2].time) < DEMO_LAST_DELAY_MS ) ){
+      fprintf(stderr, "Last command follows 0xE3 too early\n");
+      ok = false;
+    }
+    if(sim.selects != sim.commands){
+      fprintf(stderr, "%u CS assertions for %u commands\n", sim.selects, sim.commands);
+      ok = false;
+    }
+    ok = ok && (0 == sim.errors);
+    printf("BUSY low %3u ms after reset for %3u ms: wake %3u ms, %2u commands, %2u CS  %s\n", resetdelay, resetms, duration, 
+           sim.commands, sim.selects, (true == ok) ? "ok" : "FAILED");
+    panel_attach(NULL, -1, -1, -1, -1);
+    epdsim_end(&sim);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    static const uint32_t delays[] = { 0, 5, 30, 100 };
+    static const uint32_t durations[] = { 1, EPDSIM_RESET_MS, 300 };
+    bool ok = true;
+    for(uint32_t d=0;d<sizeof(delays)/sizeof(delays[0]);d++){
+      for(uint32_t l=0;l<sizeof(durations)/sizeof(durations[0]);l++){
+        ok = check(delays[d], durations[l]) && ok;
+      }
+    }
+    return (true == ok) ? 0 : 1;
+}
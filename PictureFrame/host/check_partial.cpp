@@ -0,0 +1,82 @@
+/*
+  Partial window of Epd on the controller stand-in (user-016)
+
+  check_partial
+
+  Odd and even sized overlays, also clipped at the panel border, are
+  shown with EPD_5IN65F_Display_part(). Rows are (width+1)/2 bytes, the
+  frame must hold the overlay at its place and white everywhere else,
+  the bytes behind the overlay are never read
+*/
+#include <Arduino.h>
+#include "epd5in65f.h"
+#include "panel.h"
+
+#define CHECK_GUARD 64
+
+/*-----------------------------------------
+Function  : check
+Input     : uint16_t, uint16_t, uint16_t, uint16_t
+Output    : bool
+Remarks   : shows a colored overlay of width x
+            height at x/y on a white panel
+-------------------------------------------*/
+static bool check(uint16_t x, uint16_t y, uint16_t width, uint16_t height){
+    uint32_t stride = (width+1)/2;
+    //Green behind the overlay shows up if it is read
+    uint8_t* image = (uint8_t*)malloc(stride*height+CHECK_GUARD);
+    memset(image, 0x22, stride*height+CHECK_GUARD);
+    for(uint32_t row=0;row<height;row++){
+      for(uint32_t col=0;col<width;col++){
+        uint8_t color = 3+((row+col)%4);
+        uint8_t* pixel = &image[row*stride+(col/2)];
+        *pixel = (0 == (col & 1)) ? ((*pixel & 0x0F) | (color<<4)) : ((*pixel & 0xF0) | color);
+      }
+      if(0 != (width & 1)){
+        //Pad pixel, must not show
+        image[row*stride+stride-1] = (image[row*stride+stride-1] & 0xF0) | 0x02;
+      }
+    }
+
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+    epd.Init();
+    bool ok = (EPD_OK == epd.Wake());
+    ok = ok && (EPD_OK == epd.EPD_5IN65F_Display_part(image, x, y, width, height));
+    epd.Sleep();
+
+    uint32_t wrong = 0;
+    for(uint32_t py=0;py<EPDSIM_HEIGHT;py++){
+      for(uint32_t px=0;px<EPDSIM_WIDTH;px++){
+        uint8_t value = sim.frame[py*(EPDSIM_WIDTH/2)+(px/2)];
+        value = (0 == (px & 1)) ? (value>>4) : (value & 0x0F);
+        uint8_t expected = 0x01;
+        if( (px >= x) && (px < (uint32_t)(x+width)) && (py >= y) && (py < (uint32_t)(y+height)) ){
+          expected = 3+(((py-y)+(px-x))%4);
+        }
+        if(value != expected){
+          wrong++;
+        }
+      }
+    }
+    ok = ok && (0 == wrong) && (0 == sim.errors);
+    printf("%3u x %-3u at %3u,%-3u %6u wrong pixels  %s\n", width, height, x, y, wrong, (true == ok) ? "ok" : "FAILED");
+    epdsim_end(&sim);
+    free(image);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    //x must be even, Display_part rounds it down
+    static const uint16_t overlays[][4] = {
+      {   0,   0,  64,  32 }, {   8,  16,  33,  17 }, { 100, 200,   1,   1 },
+      {  42,  10,  57,  20 }, { 590, 440,  31,  15 }, { 596,   0,   7,   3 },
+    };
+    bool ok = true;
+    for(uint32_t i=0;i<sizeof(overlays)/sizeof(overlays[0]);i++){
+      ok = check(overlays[i][0], overlays[i][1], overlays[i][2], overlays[i][3]) && ok;
+    }
+    return (true == ok) ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*
+  Order and throughput of the decode pipeline (user-012)
+
+  check_pipeline [-r] [-c bytes/s] image.bmp ...
+    -r  SPI transfers take as long as on the bus
+    -c  file reads take as long as on a card with this speed
+
+  Every image is decoded once with load_bitmap_to_sink() into memory, in
+  the calling task, and once with load_bitmap_for_epd(), where the decode
+  task hands blocks to the caller that sends them to the controller 
+  stand-in. The frame the stand-in holds must be the one in memory byte 
+  for byte, without a protocol error. A decode with a deadline that has
+  passed must stop before the frame is complete. Decode, send and pipeline time are
+  printed, with -r and -c the pipeline should take about the longer of 
+  both instead of the sum
+*/
+#include <Arduino.h>
+#include <unistd.h>
+#include "FS.h"
+#include "epd5in65f.h"
+#include "bmpreader.h"
+#include "panel.h"
+#include "host.h"
+
+#define FRAME_SIZE ((EPD_WIDTH/2)*EPD_HEIGHT)
+
+typedef struct{
+  uint8_t* frame;
+  uint32_t lines;
+  bool topfirst;
+} memory_sink_t;
+
+/*-----------------------------------------
+Function  : memory_write
+Input     : void*, const uint8_t*
+Output    : none
+Remarks   : sink storing the lines in order
+-------------------------------------------*/
+static void memory_write(void* ctx, const uint8_t* line){
+    memory_sink_t* memory = (memory_sink_t*)ctx;
+    if(memory->lines < EPD_HEIGHT){
+      uint32_t y = (true == memory->topfirst) ? (EPD_HEIGHT-1-memory->lines) : memory->lines;
+      memcpy(&memory->frame[y*(EPD_WIDTH/2)], line, EPD_WIDTH/2);
+    }
+    memory->lines++;
+}
+
+/*-----------------------------------------
+Function  : memory_begin
+Input     : void*, bool
+Output    : none
+Remarks   : the frame is kept bottom line 
+            first like in the stand-in
+-------------------------------------------*/
+static void memory_begin(void* ctx, bool topfirst){
+    ((memory_sink_t*)ctx)->topfirst = topfirst;
+}
+
+/*-----------------------------------------
+Function  : check
+Input     : const std::string&
+Output    : bool
+Remarks   : decodes the image both ways and
+            compares the frames
+-------------------------------------------*/
+static bool check(const std::string& image){
+    size_t slash = image.find_last_of('/');
+    std::string dir = (std::string::npos == slash) ? "." : image.substr(0, slash);
+    std::string name = (std::string::npos == slash) ? image : image.substr(slash+1);
+    FS fs(dir.c_str());
+
+    memory_sink_t memory = { (uint8_t*)malloc(FRAME_SIZE), 0, false };
+    bmp_sink_t sink = { memory_write, &memory, memory_begin };
+    uint64_t start = host_time_us();
+    bool direct = load_bitmap_to_sink(fs, "", name.c_str(), &sink);
+    uint64_t decodetime = host_time_us()-start;
+
+    memory_sink_t late = { (uint8_t*)malloc(FRAME_SIZE), 0, false };
+    bmp_sink_t latesink = { memory_write, &late, memory_begin };
+    bool stopped = (false == load_bitmap_to_sink(fs, "", name.c_str(), &latesink, (millis()-1) | 1)) && (late.lines < EPD_HEIGHT);
+    free(late.frame);
+
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+    epd.Init();
+    bool pipeline = (EPD_OK == epd.Wake());
+    start = host_time_us();
+    pipeline = pipeline && load_bitmap_for_epd(fs, "", name.c_str(), epd);
+    uint64_t pipelinetime = host_time_us()-start;
+    uint64_t sendtime = ( (uint64_t)FRAME_SIZE*8*1000000ULL )/SPI.clock();
+    pipeline = pipeline && (EPD_OK == epd.EPD_5IN65F_Refresh());
+    epd.Sleep();
+
+    bool ok = (true == direct) && (true == pipeline) && (true == stopped) && (EPD_HEIGHT == memory.lines) &&
+              (0 == memcmp(sim.frame, memory.frame, FRAME_SIZE)) && (0 == sim.errors);
+    printf("%-28s decode %7.1f ms, send %7.1f ms, pipeline %7.1f ms  %s\n", name.c_str(), decodetime/1000.0, 
+           (true == panel_spi_realtime) ? sendtime/1000.0 : 0.0, pipelinetime/1000.0, (true == ok) ? "ok" : "FAILED");
+    if(false == ok){
+      fprintf(stderr, "%s: direct %i, pipeline %i, deadline %i, %u lines, %u protocol errors\n", name.c_str(), direct, pipeline, stopped, memory.lines, sim.errors);
+    }
+    panel_attach(NULL, -1, -1, -1, -1);
+    epdsim_end(&sim);
+    free(memory.frame);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    int option;
+    while(-1 != (option = getopt(argc, argv, "rc:"))){
+      if('r' == option){
+        panel_spi_realtime = true;
+      } else if('c' == option){
+        fs::host_read_speed = atoi(optarg);
+      } else {
+        fprintf(stderr, "usage: %s [-r] [-c bytes/s] image.bmp ...\n", argv[0]);
+        return 2;
+      }
+    }
+    if(optind >= argc){
+      fprintf(stderr, "usage: %s [-r] [-c bytes/s] image.bmp ...\n", argv[0]);
+      return 2;
+    }
+    bool ok = true;
+    for(int i=optind;i<argc;i++){
+      ok = check(argv[i]) && ok;
+    }
+    return (true == ok) ? 0 : 1;
+}
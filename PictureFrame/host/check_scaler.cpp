@@ -0,0 +1,66 @@
+/*
+  Scaler window for odd image sizes (user-008)
+
+  check_scaler
+
+  For extreme and ordinary source sizes in crop and letterbox mode the
+  output must have at least one line and column, fit the display, the 
+  window must be inside the source and feeding all window lines must 
+  give exactly outheight display lines
+*/
+#include <Arduino.h>
+#include "scaler.h"
+
+/*-----------------------------------------
+Function  : check
+Input     : uint32_t, uint32_t, bool
+Output    : bool
+Remarks   : runs a gray source of width x 
+            height through the scaler
+-------------------------------------------*/
+static bool check(uint32_t width, uint32_t height, bool letterbox){
+    scaler_t scaler;
+    if(false == scaler_begin(&scaler, width, height, letterbox)){
+      printf("%5u x %-5u %-9s no memory\n", width, height, (true == letterbox) ? "letterbox" : "crop");
+      return false;
+    }
+    bool ok = (scaler.outwidth >= 1) && (scaler.outheight >= 1) &&
+              ( (scaler.outx+scaler.outwidth) <= EPD_WIDTH ) && ( (scaler.outy+scaler.outheight) <= EPD_HEIGHT ) &&
+              (scaler.windowwidth >= 1) && (scaler.windowheight >= 1) &&
+              ( (scaler.windowx+scaler.windowwidth) <= width ) && ( (scaler.windowy+scaler.windowheight) <= height );
+    uint32_t lines = 0;
+    if(true == ok){
+      uint8_t* bgr = (uint8_t*)malloc(width*3);
+      uint8_t out[EPD_WIDTH*3];
+      memset(bgr, 0x80, width*3);
+      for(uint32_t y=0;y<scaler.windowheight;y++){
+        if(true == scaler_add_row(&scaler, bgr, out)){
+          lines++;
+          //Gray inside, white borders
+          for(uint32_t x=0;x<EPD_WIDTH;x++){
+            bool inside = (x >= scaler.outx) && (x < (scaler.outx+scaler.outwidth));
+            ok = ok && (out[x*3] == ( (true == inside) ? 0x80 : 0xFF ));
+          }
+        }
+      }
+      free(bgr);
+      ok = ok && (lines == scaler.outheight);
+    }
+    printf("%5u x %-5u %-9s -> %3u x %-3u at %3u,%-3u window %4u x %-4u %s\n", width, height, (true == letterbox) ? "letterbox" : "crop",
+           scaler.outwidth, scaler.outheight, scaler.outx, scaler.outy, scaler.windowwidth, scaler.windowheight, (true == ok) ? "ok" : "FAILED");
+    scaler_end(&scaler);
+    return ok;
+}
+
+int main(int argc, char** argv){
+    static const uint32_t sizes[][2] = {
+      { 1, 1 }, { 1, 8192 }, { 8192, 1 }, { 2, 8192 }, { 8192, 3 }, { 8192, 8192 },
+      { 600, 448 }, { 448, 600 }, { 601, 449 }, { 1024, 768 }, { 333, 201 }, { 4000, 3000 },
+    };
+    bool ok = true;
+    for(uint32_t i=0;i<sizeof(sizes)/sizeof(sizes[0]);i++){
+      ok = check(sizes[i][0], sizes[i][1], false) && ok;
+      ok = check(sizes[i][0], sizes[i][1], true) && ok;
+    }
+    return (true == ok) ? 0 : 1;
+}
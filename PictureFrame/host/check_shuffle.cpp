@@ -0,0 +1,82 @@
+/*
+  Checks shuffle_index() (user-022)
+
+  check_shuffle
+
+  For every count up to CHECK_MAX_COUNT and a few large ones, each seed 
+  must give a permutation of 0..count-1, different seeds must give
+  different orders and the first image of a cycle must be about evenly 
+  spread over all images
+*/
+#include <Arduino.h>
+#include <vector>
+#include "shuffle.h"
+
+#define CHECK_MAX_COUNT 1000
+#define CHECK_SEEDS 8
+#define CHECK_SPREAD_COUNT 10
+#define CHECK_SPREAD_SEEDS 20000
+
+/*-----------------------------------------
+Function  : is_permutation
+Input     : uint32_t, uint32_t
+Output    : bool
+Remarks   : every value comes exactly once
+-------------------------------------------*/
+static bool is_permutation(uint32_t count, uint32_t seed){
+    std::vector<bool> seen(count, false);
+    for(uint32_t i=0;i<count;i++){
+      uint32_t value = shuffle_index(i, count, seed);
+      if( (value >= count) || (true == seen[value]) ){
+        fprintf(stderr, "count %u seed 0x%08x: position %u gives %u\n", count, seed, i, value);
+        return false;
+      }
+      seen[value] = true;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    bool ok = true;
+    uint32_t seeds[CHECK_SEEDS];
+    for(uint32_t s=0;s<CHECK_SEEDS;s++){
+      seeds[s] = esp_random();
+    }
+    seeds[0] = 0;
+    for(uint32_t count=0;(count<=CHECK_MAX_COUNT) && (true == ok);count++){
+      for(uint32_t s=0;(s<CHECK_SEEDS) && (true == ok);s++){
+        ok = is_permutation(count, seeds[s]);
+      }
+    }
+    static const uint32_t large[] = { 4097, 65535, 65536, 65537, 300000 };
+    for(uint32_t i=0;(i<sizeof(large)/sizeof(large[0])) && (true == ok);i++){
+      ok = is_permutation(large[i], seeds[1]) && is_permutation(large[i], seeds[2]);
+    }
+    printf("Permutations for 0..%u images and %u seeds, large counts: %s\n", CHECK_MAX_COUNT, CHECK_SEEDS, (true == ok) ? "ok" : "FAILED");
+
+    //Two seeds giving the same order for 100 images would be a weak round function
+    bool differ = true;
+    for(uint32_t s=1;s<CHECK_SEEDS;s++){
+      bool same = true;
+      for(uint32_t i=0;(i<100) && (true == same);i++){
+        same = (shuffle_index(i, 100, seeds[s]) == shuffle_index(i, 100, seeds[s-1]));
+      }
+      differ = differ && (false == same);
+    }
+    printf("Different seeds give different orders: %s\n", (true == differ) ? "ok" : "FAILED");
+
+    //First image of a cycle, every one of CHECK_SPREAD_COUNT within 10% of the mean
+    uint32_t hits[CHECK_SPREAD_COUNT] = { 0 };
+    for(uint32_t s=0;s<CHECK_SPREAD_SEEDS;s++){
+      hits[shuffle_index(0, CHECK_SPREAD_COUNT, esp_random())]++;
+    }
+    bool spread = true;
+    const uint32_t mean = CHECK_SPREAD_SEEDS/CHECK_SPREAD_COUNT;
+    printf("First image over %u seeds:", CHECK_SPREAD_SEEDS);
+    for(uint32_t i=0;i<CHECK_SPREAD_COUNT;i++){
+      printf(" %u", hits[i]);
+      spread = spread && (hits[i] > (mean*9)/10) && (hits[i] < (mean*11)/10);
+    }
+    printf(": %s\n", (true == spread) ? "ok" : "FAILED");
+    return ( (true == ok) && (true == differ) && (true == spread) ) ? 0 : 1;
+}
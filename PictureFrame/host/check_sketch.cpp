@@ -0,0 +1,273 @@
+/*
+  Boots of the whole sketch on the host (user-020)
+
+  check_sketch [-v]
+    -v  print the log of the sketch
+
+  setup() of PictureFrame.ino runs again and again against the controller
+  stand-in, a card directory, preferences and a cache partition kept in
+  memory. Deep sleep ends a boot, the RTC state stays like on the ESP32.
+  Checked are the cycle over the images from card and cache, the skipped
+  refresh of the same file, the restart after a power loss and the
+  images from flash without a card and with an empty battery
+*/
+#include <Arduino.h>
+#include <unistd.h>
+#include "freertos/task.h"
+#include "panel.h"
+#include "bmpfile.h"
+#include "host.h"
+
+/* The monitor task is not started, a boot never takes 60 s on the host */
+#define xTaskCreate check_task_create
+/* Deep sleep ends the boot instead of the run */
+#define esp_deep_sleep_start check_deep_sleep
+#define esp_sleep_enable_timer_wakeup check_timer_wakeup
+
+typedef struct {
+  uint64_t sleep_us;     //deep sleep time
+} boot_end_t;
+
+static uint64_t check_sleep_us = 0;
+
+static BaseType_t check_task_create(void (*task)(void*), const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* handle){
+    return pdPASS;
+}
+
+static esp_err_t check_timer_wakeup(uint64_t time_us){
+    check_sleep_us = time_us;
+    return ESP_OK;
+}
+
+static void check_deep_sleep(void){
+    boot_end_t end = { check_sleep_us };
+    throw end;
+}
+
+#include "PictureFrame.ino"
+
+#define CHECK_IMAGES 3
+
+static epdsim_t sim;
+
+/*-----------------------------------------
+Function  : boot
+Input     : none
+Output    : uint64_t
+Remarks   : one boot up to the deep sleep,
+            everything but the RTC memory is
+            new, returns the sleep time in us
+-------------------------------------------*/
+static uint64_t boot(void){
+    lc = Adafruit_LC709203F();
+    preferences = Preferences();
+    epd = Epd(&SPI,epd_DIN, epd_CS, epd_CLK, epd_RST, epd_DC, epd_BUSY );
+    memset(&battery, 0, sizeof(battery));
+    MonitorTaskHandle = NULL;
+    monitor_start = 0;
+    frame_file_hash = 0;
+    frame_on_display = false;
+    image_cache = NULL;
+    check_sleep_us = 0;
+    try {
+      setup();
+    } catch(boot_end_t end) {
+      return end.sleep_us;
+    }
+    return 0;
+}
+
+/*-----------------------------------------
+Function  : frame_color
+Input     : none
+Output    : int
+Remarks   : color of a frame with one color,
+            -1 for any other
+-------------------------------------------*/
+static int frame_color(void){
+    uint8_t first = sim.frame[0];
+    if( (first>>4) != (first & 0x0F) ){
+      return -1;
+    }
+    for(uint32_t i=0;i<(EPDSIM_WIDTH/2)*EPDSIM_HEIGHT;i++){
+      if(first != sim.frame[i]){
+        return -1;
+      }
+    }
+    return first & 0x0F;
+}
+
+/*-----------------------------------------
+Function  : new_card
+Input     : uint32_t
+Output    : none
+Remarks   : card with images of one color
+            each, the first is red
+-------------------------------------------*/
+static void new_card(uint32_t images){
+    if(0 != system("rm -rf " HOST_CARD_DIR " && mkdir -p " HOST_CARD_DIR "/images")){
+      fprintf(stderr, "Can't create " HOST_CARD_DIR "\n");
+      exit(1);
+    }
+    static const uint8_t colors[] = { EPD_5IN65F_RED, EPD_5IN65F_BLUE, EPD_5IN65F_GREEN, EPD_5IN65F_YELLOW };
+    uint8_t* index = (uint8_t*)malloc(EPD_WIDTH*EPD_HEIGHT);
+    for(uint32_t i=0;i<images;i++){
+      char path[128];
+      snprintf(path, sizeof(path), HOST_CARD_DIR "/images/image%u.bmp", i);
+      memset(index, colors[i], EPD_WIDTH*EPD_HEIGHT);
+      bmpfile_write4(path, index, EPD_WIDTH, EPD_HEIGHT, &bmpfile_epd_palette[0][0], 8, false, false);
+    }
+    free(index);
+}
+
+/*-----------------------------------------
+Function  : new_frame
+Input     : none
+Output    : none
+Remarks   : power loss, RTC state and the
+            preferences are gone
+-------------------------------------------*/
+static void new_frame(void){
+    memset(&state, 0, sizeof(state));
+    host_preferences_clear();
+}
+
+/*-----------------------------------------
+Function  : report
+Input     : const char*, bool
+Output    : bool
+Remarks   : prints one result
+-------------------------------------------*/
+static bool report(const char* text, bool ok){
+    printf("%-56s %s\n", text, (true == ok) ? "ok" : "FAILED");
+    return ok;
+}
+
+/*-----------------------------------------
+Function  : check_cycle
+Input     : none
+Output    : bool
+Remarks   : two cycles over the images, the
+            first boot reads the card and fills
+            the cache, the next ones show the
+            cache with the card unpowered
+-------------------------------------------*/
+static bool check_cycle(void){
+    new_frame();
+    new_card(CHECK_IMAGES);
+    host_card_present = true;
+    host_battery_percent = 80.0f;
+    host_imgcache_size = 4*IMAGE_CACHE_SLOT_SIZE;
+    bool ok = true;
+
+    uint32_t mounts = host_card_mounts;
+    uint64_t sleep_us = boot();
+    int color = frame_color();
+    ok = report("first boot shows an image from the card", (SLEEP_TIME_1d == sleep_us) && (1 == sim.refreshes) && (color >= 0)) && ok;
+    //More slots than images, the fill ends with the cycle
+    ok = report("first boot fills the cache up to the end of the cycle", (mounts+1 == host_card_mounts) && (CHECK_IMAGES-1 == state.cache_count)) && ok;
+
+    //Every image once per cycle, a cycle ends with the cache used up
+    uint32_t shown[16] = { 0 };
+    shown[color & 0x0F]++;
+    bool cached = true;
+    for(uint32_t i=1;i<2*CHECK_IMAGES;i++){
+      mounts = host_card_mounts;
+      bool fromcache = image_cache_ready();
+      sleep_us = boot();
+      color = frame_color();
+      if( (SLEEP_TIME_1d != sleep_us) || (color < 0) ){
+        ok = report("boot shows an image", false) && ok;
+        break;
+      }
+      shown[color]++;
+      if( (true == fromcache) && (mounts != host_card_mounts) ){
+        cached = false;
+      }
+    }
+    ok = report("cached images are shown without the card", true == cached) && ok;
+    bool once = true;
+    for(uint32_t i=0;i<16;i++){
+      if( (0 != shown[i]) && (2 != shown[i]) ){
+        once = false;
+      }
+    }
+    ok = report("every image once per cycle", true == once) && ok;
+    ok = report("refreshes and skipped refreshes add up to the boots",
+                (sim.refreshes == state.refreshes) && (state.refreshes+state.skipped == 2*CHECK_IMAGES)) && ok;
+    return ok;
+}
+
+/*-----------------------------------------
+Function  : check_skip
+Input     : none
+Output    : bool
+Remarks   : a card with one image, the second
+            boot finds it on the display
+-------------------------------------------*/
+static bool check_skip(void){
+    new_frame();
+    new_card(1);
+    host_card_present = true;
+    host_imgcache_size = 0;
+    bool ok = true;
+
+    uint32_t refreshes = sim.refreshes;
+    boot();
+    ok = report("single image is refreshed", (refreshes+1 == sim.refreshes) && (EPD_5IN65F_RED == frame_color())) && ok;
+    boot();
+    ok = report("same image again is not refreshed", (refreshes+1 == sim.refreshes) && (1 == state.skipped)) && ok;
+
+    //RTC memory lost, the state comes from the checkpoint or is new
+    memset(&state, 0, sizeof(state));
+    boot();
+    ok = report("after a power loss the image is refreshed", (refreshes+2 == sim.refreshes) && (EPD_5IN65F_RED == frame_color())) && ok;
+    return ok;
+}
+
+/*-----------------------------------------
+Function  : check_flash_images
+Input     : none
+Output    : bool
+Remarks   : images from flash without a card
+            and with an empty battery
+-------------------------------------------*/
+static bool check_flash_images(void){
+    new_frame();
+    host_imgcache_size = 0;
+    bool ok = true;
+
+    host_card_present = false;
+    uint64_t sleep_us = boot();
+    ok = report("without a card the No-SD image is shown",
+                (SLEEP_TIME_1d == sleep_us) && (0 == memcmp(sim.frame, _acNo_Sd_Card, sizeof(_acNo_Sd_Card)))) && ok;
+
+    host_card_present = true;
+    host_battery_percent = 3.0f;
+    sleep_us = boot();
+    ok = report("empty battery shows its image and sleeps a month",
+                (30*SLEEP_TIME_1d == sleep_us) && (0 == memcmp(sim.frame, _acBatteryEmpty, sizeof(_acBatteryEmpty)))) && ok;
+    ok = report("empty battery writes the checkpoint", true == preferences.isKey("state")) && ok;
+    host_battery_percent = 80.0f;
+    return ok;
+}
+
+int main(int argc, char** argv){
+    int option;
+    while(-1 != (option = getopt(argc, argv, "v"))){
+      if('v' == option){
+        host_log = true;
+      } else {
+        fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+        return 2;
+      }
+    }
+    epdsim_begin(&sim);
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    bool ok = check_cycle();
+    ok = check_skip() && ok;
+    ok = check_flash_images() && ok;
+    ok = report("no protocol error", 0 == sim.errors) && ok;
+    epdsim_end(&sim);
+    return (true == ok) ? 0 : 1;
+}
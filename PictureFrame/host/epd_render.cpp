@@ -0,0 +1,77 @@
+/*
+  Runs the display path of the frame on the host: the bitmap is read with
+  load_bitmap_for_epd() and send by Epd over the host SPI bus to the
+  controller stand-in, the refreshed frame is written as PPM.
+
+  epd_render [-v] [-r] [-o out.ppm] image.bmp
+    -v  print the log of the sketch
+    -r  SPI transfers take as long as on the bus (overlaps like the ESP32)
+    -o  PPM output, default frame.ppm
+
+  Exit code is 0 if the image was shown and the stand-in saw no protocol
+  error
+*/
+#include <Arduino.h>
+#include <unistd.h>
+#include "FS.h"
+#include "epd5in65f.h"
+#include "bmpreader.h"
+#include "panel.h"
+#include "host.h"
+
+int main(int argc, char** argv){
+    const char* output = "frame.ppm";
+    int option;
+    while(-1 != (option = getopt(argc, argv, "vro:"))){
+      switch(option){
+        case 'v':
+          host_log = true;
+          break;
+        case 'r':
+          panel_spi_realtime = true;
+          break;
+        case 'o':
+          output = optarg;
+          break;
+        default:
+          fprintf(stderr, "usage: %s [-v] [-r] [-o out.ppm] image.bmp\n", argv[0]);
+          return 2;
+      }
+    }
+    if(optind >= argc){
+      fprintf(stderr, "usage: %s [-v] [-r] [-o out.ppm] image.bmp\n", argv[0]);
+      return 2;
+    }
+    std::string image = argv[optind];
+    size_t slash = image.find_last_of('/');
+    std::string dir = (std::string::npos == slash) ? "." : image.substr(0, slash);
+    std::string name = (std::string::npos == slash) ? image : image.substr(slash+1);
+
+    epdsim_t sim;
+    epdsim_begin(&sim);
+    panel_attach(&sim, PANEL_PIN_CS, PANEL_PIN_DC, PANEL_PIN_RST, PANEL_PIN_BUSY);
+    FS fs(dir.c_str());
+    Epd epd(&SPI, PANEL_PIN_DIN, PANEL_PIN_CS, PANEL_PIN_CLK, PANEL_PIN_RST, PANEL_PIN_DC, PANEL_PIN_BUSY);
+    epd.Init();
+    bool result = (EPD_OK == epd.Wake());
+    uint64_t start = host_time_us();
+    result = result && load_bitmap_for_epd(fs, "", name.c_str(), epd);
+    uint64_t duration = host_time_us()-start;
+    result = result && (EPD_OK == epd.EPD_5IN65F_Refresh());
+    epd.Sleep();
+
+    FILE* out = fopen(output, "wb");
+    if( (NULL == out) || (false == epdsim_write_ppm(&sim, out)) ){
+      fprintf(stderr, "Can't write %s\n", output);
+      result = false;
+    }
+    if(NULL != out){
+      fclose(out);
+    }
+    epdsim_log(&sim);
+    fprintf(stderr, "%s: decode and send %.1f ms, %llu bytes on SPI, %s\n", name.c_str(), duration/1000.0,
+            (unsigned long long)panel_spi_bytes, (true == result) ? "shown" : "failed");
+    bool ok = (true == result) && (0 == sim.errors);
+    epdsim_end(&sim);
+    return (true == ok) ? 0 : 1;
+}
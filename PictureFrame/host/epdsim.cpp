@@ -0,0 +1,267 @@
+#include "epdsim.h"
+
+/* Nominal colors for the capture, index is the panel color */
+static const uint8_t epdsim_palette[8][3] = {
+  {   0,   0,   0 },  //Black
+  { 255, 255, 255 },  //White
+  {   0, 255,   0 },  //Green
+  {   0,   0, 255 },  //Blue
+  { 255,   0,   0 },  //Red
+  { 255, 255,   0 },  //Yellow
+  { 255, 128,   0 },  //Orange
+  { 192, 192, 192 }   //Clean
+};
+
+void epdsim_error(epdsim_t* sim, const char* text){
+    sim->errors++;
+    fprintf(stderr, "EPDSIM error: %s (command 0x%02x)\n", text, sim->command);
+}
+
+/*-----------------------------------------
+Function  : epdsim_set_busy
+Input     : epdsim_t*, uint32_t
+Output    : none
+Remarks   : BUSY is low for the next ms
+-------------------------------------------*/
+static void epdsim_set_busy(epdsim_t* sim, uint32_t ms){
+    sim->busyfrom = millis();
+    sim->busyuntil = sim->busyfrom+ms;
+}
+
+/*-----------------------------------------
+Function  : epdsim_expected_bytes
+Input     : epdsim_t*
+Output    : uint32_t
+Remarks   : image bytes the controller takes
+            after 0x10
+-------------------------------------------*/
+static uint32_t epdsim_expected_bytes(epdsim_t* sim){
+    if(true == sim->partial){
+      return (sim->winwidth/2)*sim->winheight;
+    }
+    return (EPDSIM_WIDTH/2)*EPDSIM_HEIGHT;
+}
+
+/*-----------------------------------------
+Function  : epdsim_store_byte
+Input     : epdsim_t*, uint8_t
+Output    : none
+Remarks   : puts the next image byte into the
+            frame, inside the partial window
+            if one is active
+-------------------------------------------*/
+static void epdsim_store_byte(epdsim_t* sim, uint8_t value){
+    uint32_t index = sim->framebytes++;
+    if(index >= epdsim_expected_bytes(sim)){
+      if(index == epdsim_expected_bytes(sim)){
+        epdsim_error(sim, "too much image data");
+      }
+      return;
+    }
+    if( (true == sim->partial) && (true == sim->topfirst) ){
+      if(0 == index){
+        epdsim_error(sim, "partial window with the gate scan turned");
+      }
+    } else if(true == sim->partial){
+      uint32_t rowbytes = sim->winwidth/2;
+      uint32_t y = sim->winy+(index/rowbytes);
+      uint32_t x = (sim->winx/2)+(index%rowbytes);
+      sim->frame[y*(EPDSIM_WIDTH/2)+x] = value;
+    } else if(true == sim->topfirst) {
+      uint32_t rowbytes = EPDSIM_WIDTH/2;
+      sim->frame[(EPDSIM_HEIGHT-1-(index/rowbytes))*rowbytes+(index%rowbytes)] = value;
+    } else {
+      sim->frame[index] = value;
+    }
+}
+
+/*-----------------------------------------
+Function  : epdsim_argument
+Input     : epdsim_t*
+Output    : none
+Remarks   : called for every data byte of a
+            command, checks the arguments once 
+            all of them are there
+-------------------------------------------*/
+static void epdsim_argument(epdsim_t* sim){
+    switch(sim->command){
+      case 0x00: //Panel setting, UD is the gate scan direction
+        if(1 == sim->dataindex){
+          sim->topfirst = (0 == (sim->args[0] & 0x08));
+        }
+        break;
+      case 0x07: //Deep sleep, needs the check code
+        if( (1 == sim->dataindex) && (0xA5 == sim->args[0]) ){
+          sim->sleeping = true;
+        }
+        break;
+      case 0x61: //Resolution
+        if(4 == sim->dataindex){
+          uint32_t w = ((uint32_t)sim->args[0]<<8) | sim->args[1];
+          uint32_t h = ((uint32_t)sim->args[2]<<8) | sim->args[3];
+          if( (EPDSIM_WIDTH != w) || (EPDSIM_HEIGHT != h) ){
+            epdsim_error(sim, "resolution is not 600 x 448");
+          }
+        }
+        break;
+      case 0x90: //Partial window, borders in steps of 8 pixel
+        if(9 == sim->dataindex){
+          uint32_t xs = ( ((uint32_t)sim->args[0]<<8) | sim->args[1] ) & 0x3F8;
+          uint32_t xe = ( ((uint32_t)sim->args[2]<<8) | sim->args[3] ) | 0x007;
+          uint32_t ys = ( ((uint32_t)sim->args[4]<<8) | sim->args[5] ) & 0x3FF;
+          uint32_t ye = ( ((uint32_t)sim->args[6]<<8) | sim->args[7] ) & 0x3FF;
+          if( (xe < xs) || (ye < ys) || (xe >= EPDSIM_WIDTH) || (ye >= EPDSIM_HEIGHT) ){
+            epdsim_error(sim, "partial window outside the panel");
+          } else {
+            sim->winx = xs;
+            sim->winy = ys;
+            sim->winwidth = xe-xs+1;
+            sim->winheight = ye-ys+1;
+          }
+        }
+        break;
+      default:
+        break;
+    }
+}
+
+void epdsim_begin(epdsim_t* sim){
+    memset(sim, 0, sizeof(epdsim_t));
+    sim->frame = (uint8_t*)malloc((EPDSIM_WIDTH/2)*EPDSIM_HEIGHT);
+    memset(sim->frame, 0x11, (EPDSIM_WIDTH/2)*EPDSIM_HEIGHT);
+    sim->resetms = EPDSIM_RESET_MS;
+}
+
+void epdsim_end(epdsim_t* sim){
+    free(sim->frame);
+    sim->frame = NULL;
+}
+
+void epdsim_reset(epdsim_t* sim){
+    sim->command = 0;
+    sim->dataindex = 0;
+    sim->poweron = false;
+    sim->sleeping = false;
+    sim->partial = false;
+    sim->topfirst = false;
+    sim->busyfrom = millis()+sim->resetdelay;
+    sim->busyuntil = sim->busyfrom+sim->resetms;
+    sim->readyat = sim->busyuntil;
+}
+
+void epdsim_select(epdsim_t* sim){
+    sim->selects++;
+}
+
+void epdsim_command(epdsim_t* sim, uint8_t command){
+    //Image data of the last command must be complete when the next one starts
+    if( (0x10 == sim->command) && (sim->framebytes < epdsim_expected_bytes(sim)) ){
+      epdsim_error(sim, "image data incomplete");
+    }
+    sim->command = command;
+    sim->dataindex = 0;
+    sim->commands++;
+    sim->transfers++;
+    if(true == sim->sleeping){
+      epdsim_error(sim, "command in deep sleep");
+      return;
+    }
+    if(NULL != sim->trace){
+      sim->trace(sim->tracectx, command, NULL, 0);
+    }
+    if(millis() < sim->readyat){
+      epdsim_error(sim, "command before the reset is done");
+    } else if( (millis() >= sim->busyfrom) && (millis() < sim->busyuntil) ){
+      epdsim_error(sim, "command while BUSY");
+    }
+    switch(command){
+      case 0x10: //Image data
+        sim->framebytes = 0;
+        break;
+      case 0x04: //Power on
+        sim->poweron = true;
+        epdsim_set_busy(sim, EPDSIM_POWERON_MS);
+        break;
+      case 0x02: //Power off
+        sim->poweron = false;
+        epdsim_set_busy(sim, EPDSIM_POWEROFF_MS);
+        break;
+      case 0x12: //Refresh
+        if(false == sim->poweron){
+          epdsim_error(sim, "refresh without power");
+        }
+        sim->refreshes++;
+        epdsim_set_busy(sim, EPDSIM_REFRESH_MS);
+        if(NULL != sim->capture){
+          epdsim_write_ppm(sim, sim->capture);
+        }
+        break;
+      case 0x91: //Partial in
+        sim->partial = true;
+        break;
+      case 0x92: //Partial out
+        sim->partial = false;
+        break;
+      default:
+        break;
+    }
+}
+
+void epdsim_data(epdsim_t* sim, const uint8_t* data, uint32_t len){
+    sim->transfers++;
+    sim->databytes += len;
+    if(true == sim->sleeping){
+      epdsim_error(sim, "data in deep sleep");
+      return;
+    }
+    if( (NULL != sim->trace) && (0x10 != sim->command) ){
+      sim->trace(sim->tracectx, sim->command, data, len);
+    }
+    for(uint32_t i=0;i<len;i++){
+      if(0x10 == sim->command){
+        epdsim_store_byte(sim, data[i]);
+      } else {
+        if(sim->dataindex < sizeof(sim->args)){
+          sim->args[sim->dataindex] = data[i];
+        }
+        sim->dataindex++;
+        epdsim_argument(sim);
+      }
+    }
+}
+
+uint32_t epdsim_busy_ms(epdsim_t* sim){
+    uint32_t now = millis();
+    return ( (now >= sim->busyfrom) && (now < sim->busyuntil) ) ? (sim->busyuntil-now) : 0;
+}
+
+uint32_t epdsim_busy_low_ms(epdsim_t* sim){
+    uint32_t now = millis();
+    if(now >= sim->busyuntil){
+      return UINT32_MAX;
+    }
+    return (now < sim->busyfrom) ? (sim->busyfrom-now) : 0;
+}
+
+bool epdsim_write_ppm(epdsim_t* sim, FILE* out){
+    //Line 0 is the bottom of the picture and every line is mirrored
+    uint8_t rgb[EPDSIM_WIDTH*3];
+    fprintf(out, "P6\n%i %i\n255\n", EPDSIM_WIDTH, EPDSIM_HEIGHT);
+    for(uint32_t y=0;y<EPDSIM_HEIGHT;y++){
+      const uint8_t* line = &sim->frame[(EPDSIM_HEIGHT-1-y)*(EPDSIM_WIDTH/2)];
+      for(uint32_t x=0;x<EPDSIM_WIDTH;x++){
+        uint32_t pos = EPDSIM_WIDTH-1-x;
+        uint8_t value = (0 == (pos & 1)) ? (line[pos/2]>>4) : line[pos/2];
+        memcpy(&rgb[x*3], epdsim_palette[value & 0x07], 3);
+      }
+      if(sizeof(rgb) != fwrite(rgb, 1, sizeof(rgb), out)){
+        return false;
+      }
+    }
+    return true;
+}
+
+void epdsim_log(epdsim_t* sim){
+    fprintf(stderr, "EPDSIM: %u refreshes, %u commands, %u data bytes, %u CS, %u SPI calls, BUSY %u ms, %u errors\n",
+            sim->refreshes, sim->commands, sim->databytes, sim->selects, sim->transfers, sim->busytime, sim->errors);
+}
@@ -0,0 +1,154 @@
+#ifndef __EPDSIM_H__
+#define __EPDSIM_H__
+
+#include <Arduino.h>
+
+/*
+  Stand-in for the panel controller on the host. panel.cpp feeds it with
+  everything Epd puts on the pins and the SPI bus. It follows the command
+  stream, keeps the frame, models the BUSY timing and counts what goes
+  over the bus. Protocol errors (wrong amount of image data, refresh
+  without power, commands while BUSY, in deep sleep or before the reset
+  is done) are logged and counted. The frame is kept bottom line first,
+  as the controller scans it with the UD bit of the panel setting set
+*/
+#define EPDSIM_WIDTH        600
+#define EPDSIM_HEIGHT       448
+
+/* BUSY time in ms for the slow commands, the refresh depends on the temperature */
+#define EPDSIM_RESET_MS      20
+#define EPDSIM_POWERON_MS   100
+#define EPDSIM_POWEROFF_MS  100
+#define EPDSIM_REFRESH_MS 12000
+
+/* Gets every command (data NULL) and the data bytes of all but the image data */
+typedef void (*epdsim_trace_fn)(void* ctx, uint8_t command, const uint8_t* data, uint32_t len);
+
+typedef struct{
+  uint32_t resetdelay;   //ms after the reset until BUSY goes low, set after epdsim_begin
+  uint32_t resetms;      //ms BUSY stays low for the reset
+  epdsim_trace_fn trace; //NULL for none
+  void* tracectx;
+  uint8_t command;       //last command
+  uint32_t dataindex;    //data bytes since the command
+  uint8_t args[16];      //first data bytes of the command
+  bool poweron;
+  bool sleeping;
+  bool partial;
+  bool topfirst;         //UD of the panel setting cleared, the first line is the top line
+  uint32_t winx;         //partial window in pixel
+  uint32_t winy;
+  uint32_t winwidth;
+  uint32_t winheight;
+  uint32_t busyfrom;     //millis() when BUSY goes low
+  uint32_t busyuntil;    //millis() when BUSY is high again
+  uint32_t readyat;      //millis() when the reset is done
+  uint8_t* frame;        //EPDSIM_WIDTH/2 x EPDSIM_HEIGHT
+  uint32_t framebytes;   //image bytes since 0x10
+  FILE* capture;         //gets a PPM of every refresh, NULL for none
+  //statistics
+  uint32_t commands;
+  uint32_t databytes;
+  uint32_t selects;      //CS assertions
+  uint32_t transfers;    //SPI calls
+  uint32_t refreshes;
+  uint32_t busytime;     //modeled BUSY time in ms
+  uint32_t errors;
+} epdsim_t;
+
+/*-----------------------------------------
+Function  : epdsim_begin
+Input     : epdsim_t*
+Output    : none
+Remarks   : clears the state and statistics
+-------------------------------------------*/
+void epdsim_begin(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_end
+Input     : epdsim_t*
+Output    : none
+Remarks   : frees the frame
+-------------------------------------------*/
+void epdsim_end(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_reset
+Input     : epdsim_t*
+Output    : none
+Remarks   : hardware reset of the controller
+-------------------------------------------*/
+void epdsim_reset(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_select
+Input     : epdsim_t*
+Output    : none
+Remarks   : CS is asserted
+-------------------------------------------*/
+void epdsim_select(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_command
+Input     : epdsim_t*, uint8_t
+Output    : none
+Remarks   : byte send with DC low
+-------------------------------------------*/
+void epdsim_command(epdsim_t* sim, uint8_t command);
+
+/*-----------------------------------------
+Function  : epdsim_data
+Input     : epdsim_t*, const uint8_t*, uint32_t
+Output    : none
+Remarks   : bytes send with DC high in one
+            SPI call
+-------------------------------------------*/
+void epdsim_data(epdsim_t* sim, const uint8_t* data, uint32_t len);
+
+/*-----------------------------------------
+Function  : epdsim_error
+Input     : epdsim_t*, const char*
+Output    : none
+Remarks   : logs and counts a protocol error,
+            also used by panel.cpp for errors
+            on the pins
+-------------------------------------------*/
+void epdsim_error(epdsim_t* sim, const char* text);
+
+/*-----------------------------------------
+Function  : epdsim_busy_ms
+Input     : epdsim_t*
+Output    : uint32_t
+Remarks   : time in ms until BUSY is high,
+            0 if it is high
+-------------------------------------------*/
+uint32_t epdsim_busy_ms(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_busy_low_ms
+Input     : epdsim_t*
+Output    : uint32_t
+Remarks   : time in ms until BUSY is low,
+            0 if it is low, UINT32_MAX if it
+            stays high
+-------------------------------------------*/
+uint32_t epdsim_busy_low_ms(epdsim_t* sim);
+
+/*-----------------------------------------
+Function  : epdsim_write_ppm
+Input     : epdsim_t*, FILE*
+Output    : bool
+Remarks   : writes the frame as binary PPM,
+            top line of the picture first
+-------------------------------------------*/
+bool epdsim_write_ppm(epdsim_t* sim, FILE* out);
+
+/*-----------------------------------------
+Function  : epdsim_log
+Input     : epdsim_t*
+Output    : none
+Remarks   : prints the statistics
+-------------------------------------------*/
+void epdsim_log(epdsim_t* sim);
+
+#endif
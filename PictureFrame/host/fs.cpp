@@ -0,0 +1,181 @@
+#include "FS.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs {
+
+uint32_t host_read_speed = 0;
+
+struct FileImpl {
+  FILE* file;
+  DIR* dir;
+  std::string path;      //path inside the FS
+  std::string hostpath;
+  std::string name;
+  const FS* fs;
+  ~FileImpl() {
+    if(NULL != file){
+      fclose(file);
+    }
+    if(NULL != dir){
+      closedir(dir);
+    }
+  }
+};
+
+static std::string basename_of(const std::string& path){
+    size_t slash = path.find_last_of('/');
+    return (std::string::npos == slash) ? path : path.substr(slash+1);
+}
+
+File::operator bool() const {
+    return (NULL != impl) && ( (NULL != impl->file) || (NULL != impl->dir) );
+}
+
+size_t File::write(uint8_t value){
+    return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* data, size_t len){
+    if( (NULL == impl) || (NULL == impl->file) ){
+      return 0;
+    }
+    return fwrite(data, 1, len, impl->file);
+}
+
+int File::available(void){
+    if( (NULL == impl) || (NULL == impl->file) ){
+      return 0;
+    }
+    return (int)(size()-position());
+}
+
+int File::read(void){
+    uint8_t value;
+    return (1 == read(&value, 1)) ? value : -1;
+}
+
+size_t File::read(uint8_t* buffer, size_t len){
+    if( (NULL == impl) || (NULL == impl->file) ){
+      return 0;
+    }
+    size_t count = fread(buffer, 1, len, impl->file);
+    if( (0 != host_read_speed) && (0 != count) ){
+      uint64_t ns = ((uint64_t)count*1000000000ULL)/host_read_speed;
+      struct timespec wait = { (time_t)(ns/1000000000ULL), (long)(ns%1000000000ULL) };
+      nanosleep(&wait, NULL);
+    }
+    return count;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+    if( (NULL == impl) || (NULL == impl->file) ){
+      return false;
+    }
+    //Like FatFs a file is not extended by a seek when it is read
+    if( (SeekSet == mode) && (pos > size()) ){
+      return false;
+    }
+    return 0 == fseek(impl->file, pos, (SeekSet == mode) ? SEEK_SET : ( (SeekCur == mode) ? SEEK_CUR : SEEK_END ));
+}
+
+size_t File::position(void) const {
+    if( (NULL == impl) || (NULL == impl->file) ){
+      return 0;
+    }
+    return ftell(impl->file);
+}
+
+size_t File::size(void) const {
+    struct stat info;
+    if( (NULL == impl) || (0 != stat(impl->hostpath.c_str(), &info)) ){
+      return 0;
+    }
+    if(NULL != impl->file){
+      fflush(impl->file);
+      fstat(fileno(impl->file), &info);
+    }
+    return info.st_size;
+}
+
+void File::close(void){
+    impl.reset();
+}
+
+const char* File::name(void) const {
+    return (NULL != impl) ? impl->name.c_str() : "";
+}
+
+bool File::isDirectory(void){
+    return (NULL != impl) && (NULL != impl->dir);
+}
+
+File File::openNextFile(const char* mode){
+    if( (NULL == impl) || (NULL == impl->dir) ){
+      return File();
+    }
+    struct dirent* entry;
+    while(NULL != (entry = readdir(impl->dir))){
+      if( (0 != strcmp(entry->d_name, ".")) && (0 != strcmp(entry->d_name, "..")) ){
+        std::string path = impl->path;
+        if( (path.empty()) || ('/' != path[path.size()-1]) ){
+          path += "/";
+        }
+        return ((FS*)impl->fs)->open((path+entry->d_name).c_str(), mode);
+      }
+    }
+    return File();
+}
+
+time_t File::getLastWrite(void){
+    struct stat info;
+    if( (NULL == impl) || (0 != stat(impl->hostpath.c_str(), &info)) ){
+      return 0;
+    }
+    return info.st_mtime;
+}
+
+std::string FS::hostpath(const char* path) const {
+    return root + (('/' == path[0]) ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode, bool create){
+    std::shared_ptr<FileImpl> impl = std::make_shared<FileImpl>();
+    impl->file = NULL;
+    impl->dir = NULL;
+    impl->path = path;
+    impl->hostpath = hostpath(path);
+    impl->name = basename_of(path);
+    impl->fs = this;
+    struct stat info;
+    if( (0 == strcmp(mode, FILE_READ)) && (0 == stat(impl->hostpath.c_str(), &info)) && (S_ISDIR(info.st_mode)) ){
+      impl->dir = opendir(impl->hostpath.c_str());
+    } else {
+      impl->file = fopen(impl->hostpath.c_str(), (0 == strcmp(mode, FILE_READ)) ? "rb" : ( (0 == strcmp(mode, FILE_APPEND)) ? "ab" : "w+b" ));
+    }
+    return File(impl);
+}
+
+bool FS::exists(const char* path){
+    struct stat info;
+    return 0 == stat(hostpath(path).c_str(), &info);
+}
+
+bool FS::remove(const char* path){
+    return 0 == unlink(hostpath(path).c_str());
+}
+
+bool FS::rename(const char* from, const char* to){
+    return 0 == ::rename(hostpath(from).c_str(), hostpath(to).c_str());
+}
+
+bool FS::mkdir(const char* path){
+    return 0 == ::mkdir(hostpath(path).c_str(), 0755);
+}
+
+bool FS::rmdir(const char* path){
+    return 0 == ::rmdir(hostpath(path).c_str());
+}
+
+}
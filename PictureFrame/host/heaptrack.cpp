@@ -0,0 +1,67 @@
+#include "heaptrack.h"
+#include <malloc.h>
+#include <atomic>
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+}
+
+static std::atomic<size_t> heap_used(0);
+static std::atomic<size_t> heap_base(0);
+static std::atomic<size_t> heap_peak(0);
+
+static void heap_add(void* ptr){
+    if(NULL == ptr){
+      return;
+    }
+    size_t used = (heap_used += malloc_usable_size(ptr));
+    size_t peak = heap_peak;
+    while( (used > peak) && (false == heap_peak.compare_exchange_weak(peak, used)) ){
+    }
+}
+
+static void heap_remove(void* ptr){
+    if(NULL != ptr){
+      heap_used -= malloc_usable_size(ptr);
+    }
+}
+
+extern "C" {
+
+void* __wrap_malloc(size_t size){
+    void* ptr = __real_malloc(size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size){
+    void* ptr = __real_calloc(count, size);
+    heap_add(ptr);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size){
+    heap_remove(ptr);
+    void* result = __real_realloc(ptr, size);
+    heap_add( (NULL != result) ? result : ( (0 != size) ? ptr : NULL ) );
+    return result;
+}
+
+void __wrap_free(void* ptr){
+    heap_remove(ptr);
+    __real_free(ptr);
+}
+
+}
+
+void heaptrack_reset(void){
+    heap_base = heap_used.load();
+    heap_peak = heap_used.load();
+}
+
+size_t heaptrack_peak(void){
+    return heap_peak-heap_base;
+}
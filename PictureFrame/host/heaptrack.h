@@ -0,0 +1,32 @@
+#ifndef __HEAPTRACK_H__
+#define __HEAPTRACK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+  Counts the heap used through malloc, calloc, realloc and free. Only
+  works for tools linked with -Wl,--wrap=malloc,--wrap=calloc,
+  --wrap=realloc,--wrap=free, see the Makefile. Task stacks are counted
+  as well, the host FreeRTOS allocates them with malloc
+*/
+
+/*-----------------------------------------
+Function  : heaptrack_reset
+Input     : none
+Output    : none
+Remarks   : peak starts again from the heap
+            in use now
+-------------------------------------------*/
+void heaptrack_reset(void);
+
+/*-----------------------------------------
+Function  : heaptrack_peak
+Input     : none
+Output    : size_t
+Remarks   : highest heap use above the use at
+            heaptrack_reset in bytes
+-------------------------------------------*/
+size_t heaptrack_peak(void);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <Arduino.h>
+
+/*-----------------------------------------
+Function  : host_skip_us
+Input     : uint64_t
+Output    : none
+Remarks   : moves the clock on without 
+            spending the time, used for
+            delay() and light sleep
+-------------------------------------------*/
+void host_skip_us(uint64_t us);
+
+/*-----------------------------------------
+Function  : host_time_us
+Input     : none
+Output    : uint64_t
+Remarks   : real time in us since the start,
+            without the skipped time
+-------------------------------------------*/
+uint64_t host_time_us(void);
+
+/*-----------------------------------------
+Function  : host_tasks_wait
+Input     : none
+Output    : none
+Remarks   : waits until every task created 
+            has returned and its stack is 
+            freed
+-------------------------------------------*/
+void host_tasks_wait(void);
+
+#endif
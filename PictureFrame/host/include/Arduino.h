@@ -0,0 +1,127 @@
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+/*
+  Just enough of the Arduino core for the sketch sources to build on a
+  Linux host. Time is the host clock plus everything delay() and light
+  sleep skipped, so a BUSY wait costs no real time while the CPU bound
+  parts are still measured as they run
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_sleep.h"
+
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLDOWN  2
+#define MSBFIRST        1
+#define SERIAL_8N1      0
+#define TX1             1
+#define I2C_POWER       7
+
+#define F(x)            x
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+
+typedef uint8_t byte;
+
+using std::min;
+using std::max;
+
+uint32_t millis(void);
+uint32_t micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+class String {
+public:
+    String(const char* text = "") : s(text) {}
+    String(const std::string& text) : s(text) {}
+    explicit String(int value) : s(std::to_string(value)) {}
+    explicit String(unsigned int value) : s(std::to_string(value)) {}
+    explicit String(long value) : s(std::to_string(value)) {}
+    explicit String(unsigned long value) : s(std::to_string(value)) {}
+    const char* c_str() const { return s.c_str(); }
+    unsigned length() const { return s.length(); }
+    void toLowerCase() { for(size_t i=0; i<s.size(); i++) { s[i] = tolower(s[i]); } }
+    bool endsWith(const char* suffix) const { size_t n = strlen(suffix); return (s.size() >= n) && (0 == s.compare(s.size()-n, n, suffix)); }
+    bool startsWith(const char* prefix) const { return 0 == s.compare(0, strlen(prefix), prefix); }
+    String operator+(const String& other) const { return String(s + other.s); }
+    String operator+(const char* other) const { return String(s + other); }
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == other; }
+    bool operator!=(const char* other) const { return s != other; }
+private:
+    std::string s;
+};
+
+inline String operator+(const char* a, const String& b) { return String(a) + b; }
+
+/* Output of Serial and Serial1 goes to stderr if host_log is set */
+extern bool host_log;
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value);
+    virtual size_t write(const uint8_t* data, size_t len);
+    size_t print(const char* text);
+    size_t print(int value);
+    size_t print(unsigned value);
+    size_t print(unsigned long value);
+    size_t print(float value, int digits = 2);
+    size_t println(const char* text = "");
+    size_t println(int value);
+    size_t println(unsigned value);
+    size_t println(unsigned long value);
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    void flush(void) {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available(void) { return 0; }
+    virtual int read(void) { return -1; }
+    size_t readBytes(char* buffer, size_t len);
+    size_t readBytes(uint8_t* buffer, size_t len) { return readBytes((char*)buffer, len); }
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud, int config = 0, int rx = -1, int tx = -1) {}
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+/* No PSRAM on the host unless host_psram_size is set */
+extern uint32_t host_psram_size;
+
+class EspClass {
+public:
+    uint32_t getPsramSize(void) { return host_psram_size; }
+};
+
+extern EspClass ESP;
+
+void* ps_malloc(size_t size);
+uint32_t esp_random(void);
+
+#endif
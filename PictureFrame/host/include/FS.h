@@ -0,0 +1,63 @@
+#ifndef __HOST_FS_H__
+#define __HOST_FS_H__
+
+/* fs::FS on a directory of the host, "/" is the root directory given to FS */
+#include "Arduino.h"
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+/* Reads take as long as on a card with this many bytes/s, 0 for no wait */
+extern uint32_t host_read_speed;
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+    operator bool() const;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    int available(void) override;
+    int read(void) override;
+    size_t read(uint8_t* buffer, size_t len);
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position(void) const;
+    size_t size(void) const;
+    void close(void);
+    const char* name(void) const;
+    bool isDirectory(void);
+    File openNextFile(const char* mode = FILE_READ);
+    time_t getLastWrite(void);
+private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+class FS {
+public:
+    FS(const char* root = ".") : root(root) {}
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+    std::string hostpath(const char* path) const;
+private:
+    std::string root;
+};
+
+}
+
+using fs::File;
+using fs::FS;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __HOST_PREFERENCES_H__
+#define __HOST_PREFERENCES_H__
+
+/* 
+  Kept in memory for the whole run, like the flash over deep sleep and
+  a power loss, host_preferences_clear() is a new flash
+*/
+#include "Arduino.h"
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readonly = false);
+    void end(void) {}
+    size_t putULong(const char* key, uint32_t value);
+    uint32_t getULong(const char* key, uint32_t value = 0);
+    size_t putUChar(const char* key, uint8_t value);
+    uint8_t getUChar(const char* key, uint8_t value = 0);
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buffer, size_t len);
+    bool isKey(const char* key);
+    bool remove(const char* key);
+private:
+    std::string name;
+};
+
+void host_preferences_clear(void);
+
+#endif
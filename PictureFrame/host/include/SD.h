@@ -0,0 +1,7 @@
+#ifndef __HOST_SD_H__
+#define __HOST_SD_H__
+
+/* The sketch only uses SD_MMC */
+#include "FS.h"
+
+#endif
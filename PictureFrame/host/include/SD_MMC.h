@@ -0,0 +1,35 @@
+#ifndef __HOST_SD_MMC_H__
+#define __HOST_SD_MMC_H__
+
+/* The card is a directory of the host, see board.cpp */
+#include "FS.h"
+
+#define CARD_NONE            0
+#define CARD_SDHC            3
+#define SDMMC_FREQ_DEFAULT   20000
+#define SDMMC_FREQ_HIGHSPEED 40000
+
+/* Directory of the card, it is missing if host_card_present is false */
+#define HOST_CARD_DIR "build/card"
+
+extern bool host_card_present;
+/* Successful mounts since the start */
+extern uint32_t host_card_mounts;
+
+class SDMMCFS : public fs::FS {
+public:
+    SDMMCFS(const char* root) : fs::FS(root) {}
+    bool setPins(int clk, int cmd, int d0, int d1 = -1, int d2 = -1, int d3 = -1) { return true; }
+    bool begin(const char* mountpoint = "/sdcard", bool mode1bit = false, bool format_if_mount_failed = false, 
+               int sdmmc_frequency = SDMMC_FREQ_DEFAULT, uint8_t maxOpenFiles = 5);
+    void end(void);
+    uint8_t cardType(void);
+    uint64_t cardSize(void);
+    uint64_t usedBytes(void);
+private:
+    bool mounted = false;
+};
+
+extern SDMMCFS SD_MMC;
+
+#endif
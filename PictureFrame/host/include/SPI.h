@@ -0,0 +1,30 @@
+#ifndef __HOST_SPI_H__
+#define __HOST_SPI_H__
+
+/* Every byte on the bus is handed to the panel stand-in, see panel.cpp */
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+
+class SPISettings {
+public:
+    SPISettings(uint32_t clock = 1000000, uint8_t order = MSBFIRST, uint8_t mode = SPI_MODE0) : clock(clock) {}
+    uint32_t clock;
+};
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1);
+    void end(void) {}
+    void beginTransaction(SPISettings settings);
+    void endTransaction(void) {}
+    uint8_t transfer(uint8_t data);
+    void writeBytes(const uint8_t* data, uint32_t len);
+    uint32_t clock(void) { return hz; }
+private:
+    uint32_t hz = 0;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __HOST_ESP_HEAP_CAPS_H__
+#define __HOST_ESP_HEAP_CAPS_H__
+
+/* All memory is the same on the host, the caps are ignored */
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_DMA       (1<<3)
+#define MALLOC_CAP_8BIT      (1<<2)
+#define MALLOC_CAP_INTERNAL  (1<<11)
+#define MALLOC_CAP_SPIRAM    (1<<10)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __HOST_ESP_PARTITION_H__
+#define __HOST_ESP_PARTITION_H__
+
+/* Data partitions in memory, see board.cpp */
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_sleep.h"
+
+#define ESP_FAIL -1
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0,
+    ESP_PARTITION_TYPE_DATA = 1
+} esp_partition_type_t;
+
+typedef int esp_partition_subtype_t;
+#define ESP_PARTITION_SUBTYPE_ANY 0xff
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+/* Size of the "imgcache" partition, 0 for none, set before the first find */
+extern uint32_t host_imgcache_size;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t len);
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t len);
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t len);
+
+#endif
@@ -0,0 +1,159 @@
+#include "panel.h"
+#include "host.h"
+#include <SPI.h>
+#include "driver/gpio.h"
+
+#define PANEL_PINS 64
+
+SPIClass SPI;
+bool panel_spi_realtime = false;
+uint64_t panel_spi_bytes = 0;
+
+static epdsim_t* panel_sim = NULL;
+static int panel_cs = -1;
+static int panel_dc = -1;
+static int panel_reset = -1;
+static int panel_busy = -1;
+static uint8_t pin_level[PANEL_PINS];
+
+static uint64_t wakeup_timer_us = 0;
+static bool wakeup_timer = false;
+static int wakeup_pin = -1;
+static int wakeup_level = HIGH;
+
+void panel_attach(epdsim_t* sim, int cs, int dc, int reset, int busy){
+    panel_sim = sim;
+    panel_cs = cs;
+    panel_dc = dc;
+    panel_reset = reset;
+    panel_busy = busy;
+}
+
+void pinMode(int pin, int mode){
+}
+
+void digitalWrite(int pin, int value){
+    if( (pin < 0) || (pin >= PANEL_PINS) ){
+      return;
+    }
+    uint8_t old = pin_level[pin];
+    pin_level[pin] = (LOW != value) ? HIGH : LOW;
+    if( (NULL == panel_sim) || (old == pin_level[pin]) ){
+      return;
+    }
+    if( (pin == panel_cs) && (LOW == pin_level[pin]) ){
+      epdsim_select(panel_sim);
+    }
+    if( (pin == panel_reset) && (HIGH == pin_level[pin]) ){
+      epdsim_reset(panel_sim);
+    }
+}
+
+int digitalRead(int pin){
+    if( (NULL != panel_sim) && (pin == panel_busy) ){
+      return (0 == epdsim_busy_ms(panel_sim)) ? HIGH : LOW;
+    }
+    if( (pin < 0) || (pin >= PANEL_PINS) ){
+      return LOW;
+    }
+    return pin_level[pin];
+}
+
+/*-----------------------------------------
+Function  : panel_spi
+Input     : const uint8_t*, uint32_t, uint32_t
+Output    : none
+Remarks   : one SPI call, a command if DC is 
+            low, takes the bus time if
+            panel_spi_realtime is set
+-------------------------------------------*/
+static void panel_spi(const uint8_t* data, uint32_t len, uint32_t hz){
+    panel_spi_bytes += len;
+    if( (true == panel_spi_realtime) && (hz > 0) ){
+      uint64_t ns = ((uint64_t)len*8*1000000000ULL)/hz;
+      struct timespec wait = { (time_t)(ns/1000000000ULL), (long)(ns%1000000000ULL) };
+      nanosleep(&wait, NULL);
+    }
+    if(NULL == panel_sim){
+      return;
+    }
+    if(HIGH == digitalRead(panel_cs)){
+      epdsim_error(panel_sim, "SPI transfer without CS");
+      return;
+    }
+    if(LOW == digitalRead(panel_dc)){
+      for(uint32_t i=0;i<len;i++){
+        epdsim_command(panel_sim, data[i]);
+      }
+    } else {
+      epdsim_data(panel_sim, data, len);
+    }
+}
+
+void SPIClass::begin(int8_t sck, int8_t miso, int8_t mosi, int8_t ss){
+}
+
+void SPIClass::beginTransaction(SPISettings settings){
+    hz = settings.clock;
+}
+
+uint8_t SPIClass::transfer(uint8_t data){
+    panel_spi(&data, 1, hz);
+    return 0;
+}
+
+void SPIClass::writeBytes(const uint8_t* data, uint32_t len){
+    panel_spi(data, len, hz);
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type){
+    wakeup_pin = pin;
+    wakeup_level = (GPIO_INTR_HIGH_LEVEL == type) ? HIGH : LOW;
+    return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin){
+    wakeup_pin = -1;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_us){
+    wakeup_timer = true;
+    wakeup_timer_us = time_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup(void){
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t source){
+    if(ESP_SLEEP_WAKEUP_TIMER == source){
+      wakeup_timer = false;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_light_sleep_start(void){
+    uint64_t sleep_us = (true == wakeup_timer) ? wakeup_timer_us : 0;
+    if( (wakeup_pin >= 0) && (NULL != panel_sim) && (wakeup_pin == panel_busy) ){
+      //BUSY changes when the model says so
+      uint32_t busy_ms = (HIGH == wakeup_level) ? epdsim_busy_ms(panel_sim) : epdsim_busy_low_ms(panel_sim);
+      uint64_t busy_us = (uint64_t)busy_ms*1000;
+      if( (UINT32_MAX != busy_ms) && ( (false == wakeup_timer) || (busy_us < sleep_us) ) ){
+        sleep_us = busy_us;
+      }
+    } else if( (wakeup_pin >= 0) && (wakeup_level == digitalRead(wakeup_pin)) ){
+      sleep_us = 0;
+    }
+    if(NULL != panel_sim){
+      panel_sim->busytime += sleep_us/1000;
+    }
+    host_skip_us(sleep_us);
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start(void){
+    fprintf(stderr, "Deep sleep, host run ends\n");
+    exit(0);
+}
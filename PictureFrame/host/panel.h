@@ -0,0 +1,36 @@
+#ifndef __PANEL_H__
+#define __PANEL_H__
+
+#include "epdsim.h"
+
+/*
+  Connects the pins and the SPI bus of the host to the controller 
+  stand-in: CS, DC and RESET go to the model, BUSY comes from it. Light
+  sleep with a BUSY wakeup moves the clock on to the moment BUSY changes
+*/
+
+/* Pins the sketch gives to Epd */
+#define PANEL_PIN_DIN   35
+#define PANEL_PIN_CLK   36
+#define PANEL_PIN_CS    37
+#define PANEL_PIN_DC    8
+#define PANEL_PIN_RST   14
+#define PANEL_PIN_BUSY  15
+
+/*-----------------------------------------
+Function  : panel_attach
+Input     : epdsim_t*, int, int, int, int
+Output    : none
+Remarks   : pins as given to the Epd class,
+            NULL detaches the model
+-------------------------------------------*/
+void panel_attach(epdsim_t* sim, int cs, int dc, int reset, int busy);
+
+/* true: every SPI transfer takes as long as on the bus, so decoding and 
+   sending can overlap like on the ESP32. false: transfers take no time */
+extern bool panel_spi_realtime;
+
+/* Bytes put on the SPI bus since the start */
+extern uint64_t panel_spi_bytes;
+
+#endif